@@ -65,6 +65,25 @@ class expected {
         template <typename U, typename... Args>
         constexpr explicit expected(unexpect_t, std::initializer_list<U>&, Args&&...);
 
+        #ifdef VIEN_EXPECTED_EXTENDED
+        template <typename A>
+        expected(std::allocator_arg_t, A const&);
+        template <typename A>
+        expected(std::allocator_arg_t, A const&, expected const&);
+        template <typename A>
+        expected(std::allocator_arg_t, A const&, expected&&);
+        template <typename A, typename U = T>
+        expected(std::allocator_arg_t, A const&, U&&);
+        template <typename A, typename G = E>
+        expected(std::allocator_arg_t, A const&, unexpected<G> const&);
+        template <typename A, typename G = E>
+        expected(std::allocator_arg_t, A const&, unexpected<G>&&);
+        template <typename A, typename... Args>
+        expected(std::allocator_arg_t, A const&, std::in_place_t, Args&&...);
+        template <typename A, typename... Args>
+        expected(std::allocator_arg_t, A const&, unexpect_t, Args&&...);
+        #endif
+
         ~expected();
 
         expected& operator=(expected const&);
@@ -160,6 +179,69 @@ class expected {
         template <typename F>
         constexpr auto map_range(F&&) const &&;
 
+        template <typename A, typename F>
+        constexpr auto map_range(std::allocator_arg_t, A const&, F&&) &;
+        template <typename A, typename F>
+        constexpr auto map_range(std::allocator_arg_t, A const&, F&&) const &;
+        template <typename A, typename F>
+        constexpr auto map_range(std::allocator_arg_t, A const&, F&&) &&;
+        template <typename A, typename F>
+        constexpr auto map_range(std::allocator_arg_t, A const&, F&&) const &&;
+
+        template <typename OutputIt, typename F>
+        constexpr expected<OutputIt, E> map_range_into(OutputIt, F&&) &;
+        template <typename OutputIt, typename F>
+        constexpr expected<OutputIt, E> map_range_into(OutputIt, F&&) const &;
+        template <typename OutputIt, typename F>
+        constexpr expected<OutputIt, E> map_range_into(OutputIt, F&&) &&;
+        template <typename OutputIt, typename F>
+        constexpr expected<OutputIt, E> map_range_into(OutputIt, F&&) const &&;
+
+        template <typename Range, typename F>
+        constexpr expected<std::size_t, E> map_range_into(Range&&, F&&) &;
+        template <typename Range, typename F>
+        constexpr expected<std::size_t, E> map_range_into(Range&&, F&&) const &;
+        template <typename Range, typename F>
+        constexpr expected<std::size_t, E> map_range_into(Range&&, F&&) &&;
+        template <typename Range, typename F>
+        constexpr expected<std::size_t, E> map_range_into(Range&&, F&&) const &&;
+
+        template <typename F>
+        auto flat_map_range(F&&) &;
+        template <typename F>
+        auto flat_map_range(F&&) const &;
+        template <typename F>
+        auto flat_map_range(F&&) &&;
+        template <typename F>
+        auto flat_map_range(F&&) const &&;
+
+        template <typename F>
+        auto filter_map_range(F&&) &;
+        template <typename F>
+        auto filter_map_range(F&&) const &;
+        template <typename F>
+        auto filter_map_range(F&&) &&;
+        template <typename F>
+        auto filter_map_range(F&&) const &&;
+
+        template <typename F>
+        auto filter_map_range(shrink_to_fit_t, F&&) &;
+        template <typename F>
+        auto filter_map_range(shrink_to_fit_t, F&&) const &;
+        template <typename F>
+        auto filter_map_range(shrink_to_fit_t, F&&) &&;
+        template <typename F>
+        auto filter_map_range(shrink_to_fit_t, F&&) const &&;
+
+        template <typename F>
+        auto try_map_range(F&&) &;
+        template <typename F>
+        auto try_map_range(F&&) const &;
+        template <typename F>
+        auto try_map_range(F&&) &&;
+        template <typename F>
+        auto try_map_range(F&&) const &&;
+
         template <typename F>
         constexpr expected<T, std::decay_t<std::invoke_result_t<F,E>>>
             map_error(F&&) &;
@@ -282,8 +364,158 @@ class bad_expected_access : public bad_expected_access<void> {
         E val_;
 };
 
+#ifdef VIEN_EXPECTED_EXTENDED
+
+__ class template pure_fn __
+
+template <typename F>
+class pure_fn {
+    public:
+        constexpr explicit pure_fn(F);
+
+        template <typename... Args>
+        constexpr std::invoke_result_t<F&, Args...> operator()(Args&&...) &;
+        template <typename... Args>
+        constexpr std::invoke_result_t<F const&, Args...> operator()(Args&&...) const &;
+
+    private:
+        F f_;
+};
+
+template <typename F>
+constexpr pure_fn<std::decay_t<F>> pure(F&&);
+
+__ fallible allocation __
+
+struct alloc_error {
+    std::size_t bytes;
+};
+
+constexpr bool operator==(alloc_error, alloc_error) noexcept;
+constexpr bool operator!=(alloc_error, alloc_error) noexcept;
+
+template <typename T, typename... Args>
+expected<std::unique_ptr<T>, alloc_error> try_make_unique(Args&&...);
+
+template <typename A>
+expected<typename std::allocator_traits<A>::pointer, alloc_error> try_allocate(A&, std::size_t);
+
+template <typename Container>
+expected<void, alloc_error> try_reserve(Container&, std::size_t);
+
+__ algorithms __
+
+template <typename Container, typename InputIt>
+expected<Container, see below> collect(InputIt, InputIt);
+template <typename Container, typename Range>
+expected<Container, see below> collect(Range&&);
+
+struct partition_counts {
+    std::size_t values;
+    std::size_t errors;
+};
+
+template <typename Range, typename ValueOut, typename ErrorOut>
+partition_counts partition_results(Range&&, ValueOut&&, ErrorOut&&);
+template <typename Range, typename ValueOut, typename ErrorOut>
+partition_counts partition_results_indexed(Range&&, ValueOut&&, ErrorOut&&);
+
+template <typename Range, typename T, typename Reduce, typename Transform>
+expected<T, see below> try_transform_reduce(Range&&, T, Reduce, Transform);
+
+__ class template accumulating __
+
+template <typename E, std::size_t N = 4>
+class accumulating {
+    public:
+        using value_type = E;
+        using size_type = std::size_t;
+        using iterator = E*;
+        using const_iterator = E const*;
+
+        accumulating() noexcept;
+        accumulating(accumulating const&);
+        accumulating(accumulating&&) noexcept(std::is_nothrow_move_constructible_v<E>);
+        accumulating& operator=(accumulating const&);
+        accumulating& operator=(accumulating&&) noexcept(std::is_nothrow_move_constructible_v<E>);
+        ~accumulating();
+
+        void push_back(E const&);
+        void push_back(E&&);
+        template <typename... Args>
+        E& emplace_back(Args&&...);
+        void clear() noexcept;
+
+        E* data() noexcept;
+        E const* data() const noexcept;
+        std::size_t size() const noexcept;
+        bool empty() const noexcept;
+
+        E& operator[](std::size_t) noexcept;
+        E const& operator[](std::size_t) const noexcept;
+
+        iterator begin() noexcept;
+        const_iterator begin() const noexcept;
+        iterator end() noexcept;
+        const_iterator end() const noexcept;
+};
+
+template <typename E, std::size_t N>
+bool operator==(accumulating<E,N> const&, accumulating<E,N> const&);
+template <typename E, std::size_t N>
+bool operator!=(accumulating<E,N> const&, accumulating<E,N> const&);
+
+template <std::size_t N = 4, typename... Exps>
+expected<std::tuple<see below...>, accumulating<see below, N>> validate_all(Exps&&...);
+
+template <std::size_t N = 4, typename V, typename... Checks>
+expected<std::decay_t<V>, accumulating<see below, N>> zip_validate(V&&, Checks&&...);
+
+template <typename... Exps>
+expected<std::tuple<see below...>, see below> zip(Exps&&...);
+
+template <typename F, typename... Exps>
+expected<see below, see below> apply(F&&, Exps&&...);
+
+__ error propagation macros __
+
+// GCC and Clang only, evaluates to the value of expr or returns its error
+#define VIEN_TRY(expr)
+// Portable, assigns the value of expr to lhs or returns its error
+#define VIEN_TRY_ASSIGN(lhs, expr)
+// Portable, returns the error of expr, if any
+#define VIEN_TRY_VOID(expr)
+
+__ coroutines __
+
+// C++20 with GCC or Clang 17 and later, available if VIEN_EXPECTED_COROUTINES
+// is defined. A function returning expected<T,E> may be a coroutine. co_await
+// on an expected<U,G> evaluates to its value or finishes the coroutine with
+// its error
+template <typename T, typename E, typename... Args>
+struct std::coroutine_traits<expected<T,E>, Args...>;
+
+// Specialize with a non-zero size to allocate the frames of coroutines
+// returning expected<T,E> from a per-thread arena of that many bytes
+template <typename T, typename E>
+struct coroutine_arena_size : std::integral_constant<std::size_t, 0> { };
+
+__ class template container_rebind_traits __
+
+template <typename Container, typename T>
+struct container_rebind_traits {
+    using type = see below;
+};
+
+#endif
+
 }
 }
+
+#ifdef VIEN_EXPECTED_EXTENDED
+template <typename T, typename E, typename A>
+struct std::uses_allocator<vien::expected<T,E>, A>;
+#endif
  */
 
 #include <initializer_list>
@@ -298,6 +530,33 @@ class bad_expected_access : public bad_expected_access<void> {
 #include <cstddef>
 #include <functional>
 #include <iterator>
+#include <new>
+#include <optional>
+#include <tuple>
+#include <vector>
+
+/* Standard arrays with more elements than this are mapped iteratively
+ * rather than through a pack expansion */
+#ifndef VIEN_EXPECTED_ARRAY_UNROLL_LIMIT
+#define VIEN_EXPECTED_ARRAY_UNROLL_LIMIT 256
+#endif
+
+/* Coroutines returning expected require the object returned by
+ * get_return_object to be converted to expected only once the coroutine
+ * first returns to its caller. GCC does so, as does Clang since version
+ * 17. Define VIEN_EXPECTED_FORCE_COROUTINES to enable them on other
+ * compilers known to defer the conversion */
+#if defined __cpp_impl_coroutine && defined __has_include
+#if __has_include(<coroutine>)
+#if (defined __GNUC__ && !defined __clang__) || \
+    (defined __clang__ && __clang_major__ >= 17) || \
+    defined VIEN_EXPECTED_FORCE_COROUTINES
+#include <cassert>
+#include <coroutine>
+#define VIEN_EXPECTED_COROUTINES
+#endif
+#endif
+#endif
 #endif
 
 namespace vien {
@@ -309,6 +568,14 @@ struct unexpect_t {
 
 inline constexpr unexpect_t unexpect{nullptr};
 
+#ifdef VIEN_EXPECTED_EXTENDED
+struct shrink_to_fit_t {
+    explicit shrink_to_fit_t() = default;
+};
+
+inline constexpr shrink_to_fit_t shrink_to_fit{};
+#endif
+
 inline namespace v1 {
 
 template <typename, typename>
@@ -320,6 +587,36 @@ class unexpected;
 template <typename>
 class bad_expected_access;
 
+#ifdef VIEN_EXPECTED_EXTENDED
+template <typename>
+class pure_fn;
+
+template <typename, typename>
+struct container_rebind_traits;
+
+/* Error reported by the fallible allocation functions. bytes is the
+ * size of the failed request, or 0 if unknown */
+struct alloc_error {
+    std::size_t bytes;
+};
+
+constexpr bool operator==(alloc_error lhs, alloc_error rhs) noexcept {
+    return lhs.bytes == rhs.bytes;
+}
+
+constexpr bool operator!=(alloc_error lhs, alloc_error rhs) noexcept {
+    return !(lhs == rhs);
+}
+
+template <typename Container>
+expected<void, alloc_error> try_reserve(Container&, std::size_t);
+
+/* Number of values and errors written by partition_results */
+struct partition_counts {
+    std::size_t values;
+    std::size_t errors;
+};
+#endif
 
 namespace expected_detail {
 
@@ -657,6 +954,46 @@ template <typename T, typename E, typename U>
 using expected_enable_explicit_forwarding_ref_ctor_t =
     typename expected_enable_explicit_forwarding_ref_ctor<T,E,U>::type;
 
+#ifdef VIEN_EXPECTED_EXTENDED
+/* True iff T is constructible from Args following the uses-allocator
+ * construction rules with an allocator of type A */
+template <typename T, typename A, typename... Args>
+struct is_uses_allocator_constructible
+    : std::conditional_t<std::uses_allocator_v<T,A>,
+        std::disjunction<std::is_constructible<T, std::allocator_arg_t, A const&, Args...>,
+                         std::is_constructible<T, Args..., A const&>>,
+        std::is_constructible<T, Args...>> { };
+
+/* void is only ever "constructed" without arguments */
+template <typename A, typename... Args>
+struct is_uses_allocator_constructible<void, A, Args...>
+    : std::bool_constant<sizeof...(Args) == 0> { };
+
+template <typename T, typename A, typename... Args>
+inline bool constexpr is_uses_allocator_constructible_v =
+    is_uses_allocator_constructible<T, A, Args...>::value;
+
+template <typename T, typename A, typename... Args>
+struct enable_if_uses_allocator_constructible
+    : std::enable_if<is_uses_allocator_constructible_v<T, A, Args...>> { };
+
+template <typename T, typename A, typename... Args>
+using enable_if_uses_allocator_constructible_t =
+    typename enable_if_uses_allocator_constructible<T, A, Args...>::type;
+
+template <typename T, typename E, typename A, typename U>
+struct expected_enable_allocator_forwarding_ref_ctor
+    : std::enable_if<is_uses_allocator_constructible_v<T, A, U&&> &&
+                    !std::is_same_v<remove_cvref_t<U>, in_place_t> &&
+                    !std::is_same_v<remove_cvref_t<U>, unexpect_t> &&
+                    !std::is_same_v<expected<T, E>, remove_cvref_t<U>> &&
+                    !std::is_same_v<unexpected<E>, remove_cvref_t<U>>> { };
+
+template <typename T, typename E, typename A, typename U>
+using expected_enable_allocator_forwarding_ref_ctor_t =
+    typename expected_enable_allocator_forwarding_ref_ctor<T,E,A,U>::type;
+#endif
+
 template <typename T, typename E>
 struct expected_enable_copy_assignment
     : std::bool_constant<std::is_copy_assignable_v<T> &&
@@ -1036,6 +1373,43 @@ struct is_char_string<T,
 template <typename T>
 inline bool constexpr is_char_string_v = is_char_string<T>::value;
 
+template <typename>
+struct is_pure_fn : std::false_type { };
+
+template <typename F>
+struct is_pure_fn<pure_fn<F>> : std::true_type { };
+
+template <typename T>
+inline bool constexpr is_pure_fn_v = is_pure_fn<T>::value;
+
+template <typename>
+struct is_expected : std::false_type { };
+
+template <typename T, typename E>
+struct is_expected<expected<T,E>> : std::true_type { };
+
+template <typename T>
+inline bool constexpr is_expected_v = is_expected<T>::value;
+
+/* True iff all of Exps are instances of expected sharing error_type */
+template <typename... Exps>
+struct are_expected_with_common_error : std::false_type { };
+
+template <typename T, typename E, typename... Ts>
+struct are_expected_with_common_error<expected<T,E>, expected<Ts,E>...> : std::true_type { };
+
+template <typename... Exps>
+inline bool constexpr are_expected_with_common_error_v =
+    are_expected_with_common_error<remove_cvref_t<Exps>...>::value;
+
+template <typename... Exps>
+struct enable_if_expected_with_common_error
+    : std::enable_if<are_expected_with_common_error_v<Exps...>> { };
+
+template <typename... Exps>
+using enable_if_expected_with_common_error_t =
+    typename enable_if_expected_with_common_error<Exps...>::type;
+
 /* Get value_type of T, if available. Otherwise, return T */
 template <typename T, typename = void>
 struct value_type_of : type_is<T> { };
@@ -1189,6 +1563,36 @@ struct rebind<Container<K, M, Args...>, T, true, false>
     static_assert(!std::is_void_v<T>, "Cannot bind mapped_type to void");
 };
 
+/* Container is a non-associative template with a non-type parameter
+ * following the value_type (e.g. an inline capacity),
+ * rebind value_type from F to T, keep N and rebind any
+ * remaining allocator, comparator or hasher. Matching a template whose
+ * non-type parameter is not declared auto requires relaxed template
+ * template argument matching (P0522), without which only std::size_t
+ * parameters are supported */
+#ifdef __cpp_template_template_args
+template <template <typename, auto, typename...> class Container,
+          typename F, auto N, typename T,
+          typename... Args>
+#else
+template <template <typename, std::size_t, typename...> class Container,
+          typename F, std::size_t N, typename T,
+          typename... Args>
+#endif
+struct rebind<Container<F, N, Args...>, T, false, false>
+    : type_is<
+        Container<T, N,
+            rebind_if_hash_t<
+                rebind_if_comparator_t<
+                    rebind_if_alloc_t<Args, T>,
+                T>,
+            T>
+        ...>
+      >
+{
+    static_assert(!std::is_void_v<T>, "Cannot bind value_type to void");
+};
+
 /* Don't rebind char strings (doing so would cause issues with
  * string manipulation functions that don't return chars, e.g.
  * std::toupper) */
@@ -1199,17 +1603,59 @@ struct rebind<String, T, B, true>
 template <typename C, typename T>
 using rebind_t = typename rebind<C,T>::type;
 
-/* Convenience meta function for invoking rebind. Calls rebind_t
+/* Rebind through the user-specializable container_rebind_traits,
+ * which default to rebind_t */
+template <typename C, typename T>
+using container_rebind_t = typename container_rebind_traits<C,T>::type;
+
+/* Convenience meta function for invoking rebind. Calls container_rebind_t
  * with T and decayed return type of invoking an instance of F with
  * an instance of T */
 template <typename T, typename F>
 struct rebind_container
-    : type_is<rebind_t<T,
+    : type_is<container_rebind_t<T,
           std::decay_t<std::invoke_result_t<F, value_type_of_t<T>>>>> { };
 
 template <typename T, typename F>
 using rebind_container_t = typename rebind_container<T,F>::type;
 
+/* Meta function used by flat_map_range. Calls container_rebind_t with T and the
+ * decayed value_type of the range returned by invoking an instance of F
+ * with an instance of T */
+template <typename T, typename F>
+struct flat_rebind_container
+    : type_is<container_rebind_t<T,
+          std::decay_t<value_type_of_t<
+              remove_cvref_t<std::invoke_result_t<F, value_type_of_t<T>>>>>>> { };
+
+template <typename T, typename F>
+using flat_rebind_container_t = typename flat_rebind_container<T,F>::type;
+
+/* Type kept by filter_map_range, F must return either std::optional<U>
+ * or std::pair<bool, U> */
+template <typename>
+struct filtered_type;
+
+template <typename U>
+struct filtered_type<std::optional<U>> : type_is<U> { };
+
+template <typename U>
+struct filtered_type<std::pair<bool, U>> : type_is<U> { };
+
+template <typename T>
+using filtered_type_t = typename filtered_type<T>::type;
+
+/* Meta function used by filter_map_range. Calls container_rebind_t with T and the
+ * type wrapped in the result of invoking an instance of F with an
+ * instance of T */
+template <typename T, typename F>
+struct filter_rebind_container
+    : type_is<container_rebind_t<T,
+          filtered_type_t<std::decay_t<std::invoke_result_t<F, value_type_of_t<T>>>>>> { };
+
+template <typename T, typename F>
+using filter_rebind_container_t = typename filter_rebind_container<T,F>::type;
+
 
 /* Check if T is a container */
 template <typename T, typename = void>
@@ -1360,6 +1806,89 @@ struct universal_inserter<Container, std::enable_if_t<!names_unary_push_back_v<C
     }
 };
 
+/* Strings of at least this many characters are mapped through a
+ * lookup table when the callable is wrapped in pure_fn */
+inline std::size_t constexpr byte_table_threshold = 256;
+
+/* True iff SrcContainer is mapped to itself, has single-byte
+ * characters and F is a pure_fn invocable with its character type */
+template <typename SrcContainer, typename DstContainer, typename F, typename = void>
+struct byte_table_applicable : std::false_type { };
+
+template <typename String, typename F>
+struct byte_table_applicable<String, String, F, std::enable_if_t<
+    is_char_string_v<String> &&
+    sizeof(typename String::value_type) == 1 &&
+    is_pure_fn_v<remove_cvref_t<F>> &&
+    std::is_invocable_v<F&, typename String::value_type&>
+>> : std::true_type { };
+
+template <typename SrcContainer, typename DstContainer, typename F>
+inline bool constexpr byte_table_applicable_v =
+    byte_table_applicable<SrcContainer, DstContainer, F>::value;
+
+/* Map each character in [first, last) to d_first. f is invoked once for
+ * each of the 256 possible byte values rather than once per character,
+ * with the same CharT argument it would see on the per-character path */
+template <typename CharT, typename F>
+void transform_bytes(CharT const* first, CharT const* last, CharT* d_first, F& f) {
+    CharT table[256];
+    for(std::size_t i = 0; i < 256; ++i) {
+        CharT c = static_cast<CharT>(static_cast<unsigned char>(i));
+        table[i] = static_cast<CharT>(std::invoke(f, c));
+    }
+
+    for(; first != last; ++first, ++d_first)
+        *d_first = table[static_cast<unsigned char>(*first)];
+}
+
+template <typename, typename = void>
+struct has_get_allocator : std::false_type { };
+
+template <typename T>
+struct has_get_allocator<T, std::void_t<decltype(std::declval<T const&>().get_allocator())>>
+    : std::true_type { };
+
+template <typename T>
+inline bool constexpr has_get_allocator_v = has_get_allocator<T>::value;
+
+/* True iff Container has an allocator_type constructible from A */
+template <typename Container, typename A, typename = void>
+struct constructible_with_allocator : std::false_type { };
+
+template <typename Container, typename A>
+struct constructible_with_allocator<Container, A,
+    std::enable_if_t<std::is_constructible_v<typename Container::allocator_type, A const&> &&
+                     std::is_constructible_v<Container, typename Container::allocator_type const&>>>
+    : std::true_type { };
+
+template <typename Container, typename A>
+inline bool constexpr constructible_with_allocator_v = constructible_with_allocator<Container, A>::value;
+
+/* Create an empty Container using alloc rebound to its allocator_type. The
+ * instance is rebound rather than passed through
+ * select_on_container_copy_construction, as the latter would reset
+ * polymorphic allocators to the default resource */
+template <typename Container, typename A>
+constexpr Container make_with_allocator(A const& alloc) {
+    return Container(typename Container::allocator_type(alloc));
+}
+
+/* Create an empty Container using the allocator of src, if any */
+template <typename Container, typename SrcContainer>
+constexpr Container empty_like(SrcContainer const& src) {
+    if constexpr(has_get_allocator_v<SrcContainer>) {
+        using alloc_t = decltype(src.get_allocator());
+        if constexpr(constructible_with_allocator_v<Container, alloc_t>)
+            return make_with_allocator<Container>(src.get_allocator());
+        else
+            return Container();
+    }
+    else {
+        return Container();
+    }
+}
+
 /* Convert instance of SrcContainer to DstContainer */
 template <typename SrcContainer, typename DstContainer, typename F, typename FRet,
           bool = is_associative_v<SrcContainer>,
@@ -1367,7 +1896,19 @@ template <typename SrcContainer, typename DstContainer, typename F, typename FRe
 struct convert {
     /* Use when std::is_same_v<SrcContainer, DstContainer> is false */
     constexpr DstContainer operator()(SrcContainer& src, F&& f) const {
-        DstContainer dst;
+        return (*this)(empty_like<DstContainer>(src), src, std::forward<F>(f));
+    }
+
+    /* Transform into the empty container dst */
+    constexpr DstContainer operator()(DstContainer dst, SrcContainer& src, F&& f) const {
+        if constexpr(byte_table_applicable_v<SrcContainer, DstContainer, F>) {
+            if(src.size() >= byte_table_threshold) {
+                dst.resize(src.size());
+                transform_bytes(src.data(), src.data() + src.size(), dst.data(), f);
+                return dst;
+            }
+        }
+
         if constexpr(supports_preallocation_v<DstContainer>)
             dst.reserve(src.size());
 
@@ -1379,6 +1920,13 @@ struct convert {
 
     /* Use in rvalue overload when std::is_same_v<SrcContainer, DstContainer> is true */
     constexpr void operator()(in_place_t, SrcContainer& src, F&& f) const {
+        if constexpr(byte_table_applicable_v<SrcContainer, DstContainer, F>) {
+            if(src.size() >= byte_table_threshold) {
+                transform_bytes(src.data(), src.data() + src.size(), src.data(), f);
+                return;
+            }
+        }
+
         std::transform(std::begin(src), std::end(src),
                        std::begin(src), std::forward<F>(f));
     };
@@ -1391,7 +1939,11 @@ template <typename SrcContainer, typename DstContainer, typename F, typename FRe
 struct convert<SrcContainer, DstContainer, F, FRet, true, false> {
     /* Use when std::is_same_v<SrcContainer, DstContainer> == false */
     constexpr DstContainer operator()(SrcContainer& src, F&& f) const {
-        DstContainer dst;
+        return (*this)(empty_like<DstContainer>(src), src, std::forward<F>(f));
+    }
+
+    /* Transform into the empty container dst */
+    constexpr DstContainer operator()(DstContainer dst, SrcContainer& src, F&& f) const {
         if constexpr(supports_preallocation_v<DstContainer>)
             dst.reserve(src.size());
 
@@ -1422,7 +1974,17 @@ template <typename T1, typename T2, std::size_t N, typename F, typename FRet, bo
 struct convert<std::array<T1,N>, std::array<T2,N>, F, FRet, false, B> {
     /* Use when std::is_same_v<T1,T2> == false */
     constexpr std::array<T2,N> operator()(std::array<T1,N>& src, F&& f) const {
-        return construct(src, std::forward<F>(f), std::make_index_sequence<N>{});
+        if constexpr(N <= VIEN_EXPECTED_ARRAY_UNROLL_LIMIT) {
+            return construct(src, std::forward<F>(f), std::make_index_sequence<N>{});
+        }
+        else if constexpr(std::is_default_constructible_v<T2>) {
+            std::array<T2,N> dst;
+            std::transform(std::begin(src), std::end(src), std::begin(dst), std::forward<F>(f));
+            return dst;
+        }
+        else {
+            return construct_uninitialized(src, std::forward<F>(f));
+        }
     }
 
     /* Use in rvalue overload when std::is_same_v<T1,T2> == true */
@@ -1436,57 +1998,477 @@ struct convert<std::array<T1,N>, std::array<T2,N>, F, FRet, false, B> {
     static constexpr std::array<T2,N> construct(std::array<T1,N> const& src, F&& f, std::index_sequence<Is...>) {
         return {std::invoke(std::forward<F>(f), src[Is])...};
     }
-};
-
-#endif
 
-/* Aggregate used for intializing unions without requiring
- * one of the actual members to be default constructible */
-struct uninitialized_t { };
+    /* Build the elements one by one in uninitialized storage for large arrays
+     * of non-default constructible types. Instantiating a pack expansion over
+     * thousands of indices is too expensive */
+    static std::array<T2,N> construct_uninitialized(std::array<T1,N> const& src, F&& f) {
+        union storage {
+            storage() noexcept { }
+            ~storage() { }
+            std::array<T2,N> arr;
+        } buf;
+
+        std::size_t i = 0u;
+        try {
+            for(; i < N; ++i)
+                ::new (static_cast<void*>(std::addressof(buf.arr[i]))) T2(std::invoke(f, src[i]));
+        }
+        catch(...) {
+            for(; i > 0u; --i)
+                buf.arr[i - 1u].~T2();
+            throw;
+        }
 
-/* Type used for representing val_ when T is cv void */
-struct void_member_t { };
+        struct guard {
+            std::array<T2,N>& arr;
+            ~guard() {
+                for(auto& elem : arr)
+                    elem.~T2();
+            }
+        } g{buf.arr};
 
-struct no_init_t {
-    explicit no_init_t() = default;
+        return std::move(buf.arr);
+    }
 };
 
-inline no_init_t constexpr no_init{};
+template <typename T>
+struct enable_if_not_container : std::enable_if<!is_container_v<T>> { };
 
-struct internal_expect_t {
-    explicit internal_expect_t() = default;
-};
+template <typename T>
+using enable_if_not_container_t = typename enable_if_not_container<T>::type;
+
+/* Transform the elements in src and write the results to out. The elements
+ * are passed to f as rvalues if src is an rvalue */
+template <typename SrcContainer, typename OutputIt, typename F>
+constexpr OutputIt transform_into(SrcContainer&& src, OutputIt out, F&& f) {
+    if constexpr(std::is_lvalue_reference_v<SrcContainer>) {
+        return std::transform(std::begin(src), std::end(src),
+                              out, std::forward<F>(f));
+    }
+    else {
+        return std::transform(std::make_move_iterator(std::begin(src)),
+                              std::make_move_iterator(std::end(src)),
+                              out, std::forward<F>(f));
+    }
+}
 
-inline internal_expect_t constexpr internal_expect{};
+/* Transform the elements in src and write the results to the range dst,
+ * stopping as soon as either of the ranges is exhausted. Returns the number
+ * of elements written */
+template <typename SrcContainer, typename DstRange, typename F>
+constexpr std::size_t transform_into_range(SrcContainer&& src, DstRange&& dst, F&& f) {
+    auto first = std::begin(src);
+    auto const last = std::end(src);
+    auto d_first = std::begin(dst);
+    auto const d_last = std::end(dst);
+
+    std::size_t n = 0;
+    for(; first != last && d_first != d_last; ++first, ++d_first, ++n) {
+        if constexpr(std::is_lvalue_reference_v<SrcContainer>)
+            *d_first = std::invoke(f, *first);
+        else
+            *d_first = std::invoke(f, std::move(*first));
+    }
+    return n;
+}
 
-struct internal_unexpect_t {
-    explicit internal_unexpect_t() = default;
-};
+template <typename>
+struct is_std_array : std::false_type { };
 
-inline internal_unexpect_t constexpr internal_unexpect{};
+template <typename T, std::size_t N>
+struct is_std_array<std::array<T,N>> : std::true_type { };
 
-/* expected hierarchy */
+template <typename T>
+inline bool constexpr is_std_array_v = is_std_array<T>::value;
 
-/* expected_base */
-/* Provides constexpr default constructor, destructor
- * and internal storage */
+template <typename, typename = void>
+struct is_sized : std::false_type { };
 
-template <typename T, typename E,
-          bool = std::is_trivially_destructible_v<T>,
-          bool = std::is_trivially_destructible_v<E>>
-struct expected_base;
+template <typename T>
+struct is_sized<T, std::void_t<decltype(std::declval<T const&>().size())>>
+    : std::true_type { };
 
-/* Both T and E are trivially destructible, expected should be
- * trivially destructible */
-template <typename T, typename E>
-struct expected_base<T, E, true, true> {
+template <typename T>
+inline bool constexpr is_sized_v = is_sized<T>::value;
 
-    constexpr expected_base() : has_val_(true), val_(T()) { }
-    constexpr expected_base(no_init_t) : has_val_{false}, uninitialized_{} { }
+/* Range is deemed owning if it names an allocator_type or is a standard
+ * array. Its elements may then be moved from if it is an rvalue */
+template <typename, typename = void>
+struct is_owning_range : std::false_type { };
 
-    template <typename... Args>
-    constexpr expected_base(internal_expect_t, Args&&... args) noexcept(std::is_nothrow_constructible_v<T, Args&&...>)
-        : has_val_(true), val_(std::forward<Args>(args)...) { }
+template <typename T>
+struct is_owning_range<T, std::void_t<typename T::allocator_type>>
+    : std::true_type { };
+
+template <typename T, std::size_t N>
+struct is_owning_range<std::array<T,N>> : std::true_type { };
+
+template <typename T>
+inline bool constexpr is_owning_range_v = is_owning_range<T>::value;
+
+/* Like convert but reports allocation failure as alloc_error rather than
+ * throwing. The destination is reserved through try_reserve before any
+ * element is transformed */
+template <typename SrcContainer, typename DstContainer, typename F, typename FRet>
+expected<DstContainer, alloc_error> try_convert(SrcContainer& src, F&& f) {
+    using convert_t = convert<SrcContainer, DstContainer, F, FRet>;
+    try {
+        if constexpr(is_std_array_v<DstContainer>) {
+            return convert_t{}(src, std::forward<F>(f));
+        }
+        else {
+            DstContainer dst = empty_like<DstContainer>(src);
+            if(auto res = try_reserve(dst, src.size()); !res)
+                return unexpected(res.error());
+
+            return convert_t{}(std::move(dst), src, std::forward<F>(f));
+        }
+    }
+    catch(std::bad_alloc const&) {
+        return unexpected(alloc_error{0u});
+    }
+}
+
+/* Insert the values of the expecteds in [first, last) into a new
+ * Container, stopping at the first error. n is used as preallocation
+ * hint */
+template <typename Container, typename InputIt>
+expected<Container, typename std::iterator_traits<InputIt>::value_type::error_type>
+collect_n(InputIt first, InputIt last, std::size_t n) {
+    using expected_t = typename std::iterator_traits<InputIt>::value_type;
+    static_assert(is_expected_v<expected_t>, "Elements must be instances of expected");
+    static_assert(!is_std_array_v<Container>, "Cannot collect into a standard array");
+
+    using result_t = expected<Container, typename expected_t::error_type>;
+
+    Container dst;
+    if constexpr(supports_preallocation_v<Container>)
+        dst.reserve(n);
+
+    auto out = universal_inserter<Container>{}(dst);
+    for(; first != last; ++first) {
+        decltype(auto) e = *first;
+        if(!bool(e))
+            return result_t(unexpect, std::forward<decltype(e)>(e).error());
+
+        *out = *std::forward<decltype(e)>(e);
+        ++out;
+    }
+
+    return result_t(std::move(dst));
+}
+
+/* Value produced by the VIEN_TRY family of macros once e is known to
+ * hold a value */
+template <typename Exp>
+constexpr decltype(auto) try_unwrap(Exp&& e) noexcept {
+    if constexpr(std::is_void_v<typename remove_cvref_t<Exp>::value_type>)
+        return;
+    else
+        return *std::forward<Exp>(e);
+}
+
+/* Construct Result from the error of the first of e, es... holding one.
+ * At least one of them must hold an error */
+template <typename Result, typename Exp, typename... Exps>
+Result first_error(Exp&& e, Exps&&... es) {
+    if constexpr(sizeof...(Exps) == 0u) {
+        return Result(unexpect, std::forward<Exp>(e).error());
+    }
+    else {
+        if(!bool(e))
+            return Result(unexpect, std::forward<Exp>(e).error());
+        return first_error<Result>(std::forward<Exps>(es)...);
+    }
+}
+
+/* Output iterator for Dst. Containers are inserted into using
+ * universal_inserter, after reserving n additional elements, while
+ * output iterators are used as is */
+template <typename Dst>
+auto output_for(Dst&& dst, std::size_t n) {
+    using dst_t = remove_cvref_t<Dst>;
+    if constexpr(is_container_v<dst_t>) {
+        static_assert(std::is_lvalue_reference_v<Dst>, "Destination container must be an lvalue");
+        static_assert(!is_std_array_v<dst_t>, "Cannot partition into a standard array");
+        if constexpr(supports_preallocation_v<dst_t>)
+            dst.reserve(dst.size() + n);
+        return universal_inserter<dst_t>{}(dst);
+    }
+    else {
+        (void)n;
+        return dst_t(std::forward<Dst>(dst));
+    }
+}
+
+/* Write the values and errors in r to value_out and error_out, respectively.
+ * If Indexed is true, each element is paired with its position in r */
+template <bool Indexed, typename Range, typename ValueOut, typename ErrorOut>
+partition_counts partition_results(Range&& r, ValueOut&& value_out, ErrorOut&& error_out) {
+    using range_t = remove_cvref_t<Range>;
+    static_assert(is_expected_v<remove_cvref_t<value_type_of_t<range_t>>>,
+                  "Elements must be instances of expected");
+
+    std::size_t n = 0u;
+    if constexpr(is_sized_v<range_t>)
+        n = r.size();
+
+    auto vit = output_for(std::forward<ValueOut>(value_out), n);
+    auto eit = output_for(std::forward<ErrorOut>(error_out), 0u);
+
+    partition_counts counts{0u, 0u};
+    std::size_t idx = 0u;
+    for(auto&& e : r) {
+        using elem_t = std::conditional_t<std::is_lvalue_reference_v<Range>,
+                                          decltype(e), std::remove_reference_t<decltype(e)>&&>;
+        if(bool(e)) {
+            if constexpr(Indexed)
+                *vit = std::make_pair(idx, *static_cast<elem_t>(e));
+            else
+                *vit = *static_cast<elem_t>(e);
+            ++vit;
+            ++counts.values;
+        }
+        else {
+            if constexpr(Indexed)
+                *eit = std::make_pair(idx, static_cast<elem_t>(e).error());
+            else
+                *eit = static_cast<elem_t>(e).error();
+            ++eit;
+            ++counts.errors;
+        }
+        ++idx;
+    }
+
+    return counts;
+}
+
+template <typename, typename = void>
+struct supports_shrink_to_fit : std::false_type { };
+
+template <typename T>
+struct supports_shrink_to_fit<T, std::void_t<decltype(std::declval<T&>().shrink_to_fit())>>
+    : std::true_type { };
+
+template <typename T>
+inline bool constexpr supports_shrink_to_fit_v = supports_shrink_to_fit<T>::value;
+
+template <typename U>
+constexpr bool is_kept(std::optional<U> const& o) noexcept {
+    return o.has_value();
+}
+
+template <typename U>
+constexpr bool is_kept(std::pair<bool, U> const& p) noexcept {
+    return p.first;
+}
+
+template <typename U>
+constexpr U&& kept_value(std::optional<U>&& o) noexcept {
+    return std::move(*o);
+}
+
+template <typename U>
+constexpr U&& kept_value(std::pair<bool, U>&& p) noexcept {
+    return std::move(p.second);
+}
+
+/* Invoke f on each element in src and insert the kept results into
+ * a new DstContainer. As with convert, a non-pair result is mapped to
+ * the mapped_type if src is associative. The destination is preallocated
+ * for src.size() elements and, if shrink is true, shrunk afterwards */
+template <typename DstContainer, typename SrcContainer, typename F>
+DstContainer filter_convert(SrcContainer&& src, F&& f, bool shrink) {
+    static_assert(!is_std_array_v<DstContainer>,
+                  "Cannot filter into a standard array");
+    using src_t = remove_cvref_t<SrcContainer>;
+
+    DstContainer dst = empty_like<DstContainer>(src);
+    if constexpr(supports_preallocation_v<DstContainer> && is_sized_v<src_t>)
+        dst.reserve(src.size());
+
+    auto out = universal_inserter<DstContainer>{}(dst);
+    for(auto&& elem : src) {
+        auto res = [&]() {
+            if constexpr(std::is_lvalue_reference_v<SrcContainer>)
+                return std::invoke(f, elem);
+            else
+                return std::invoke(f, std::move(elem));
+        }();
+
+        if(!is_kept(res))
+            continue;
+
+        if constexpr(is_associative_v<src_t> &&
+                    !is_pair_v<filtered_type_t<decltype(res)>>)
+            *out = std::make_pair(elem.first, kept_value(std::move(res)));
+        else
+            *out = kept_value(std::move(res));
+        ++out;
+    }
+
+    if constexpr(supports_shrink_to_fit_v<DstContainer>) {
+        if(shrink)
+            dst.shrink_to_fit();
+    }
+    return dst;
+}
+
+/* Invoke f on each element in src and concatenate the returned ranges
+ * into a new DstContainer. If f returns standard arrays, the size of the
+ * result is known up front. If it returns other sized ranges, they are
+ * collected first, one per element in src, so that the destination is
+ * allocated once for the sum of their sizes */
+template <typename DstContainer, typename SrcContainer, typename F>
+DstContainer flatten(SrcContainer&& src, F&& f) {
+    static_assert(!is_std_array_v<DstContainer>,
+                  "Cannot flatten into a standard array");
+
+    using elem_t = std::conditional_t<std::is_lvalue_reference_v<SrcContainer>,
+                                      decltype(*std::begin(src)),
+                                      decltype(std::move(*std::begin(src)))>;
+    using inner_ref_t = std::invoke_result_t<F&, elem_t>;
+    using inner_result_t = remove_cvref_t<inner_ref_t>;
+
+    auto invoke = [&f](auto&& elem) -> decltype(auto) {
+        if constexpr(std::is_lvalue_reference_v<SrcContainer>)
+            return std::invoke(f, elem);
+        else
+            return std::invoke(f, std::move(elem));
+    };
+
+    DstContainer dst = empty_like<DstContainer>(src);
+    auto out = universal_inserter<DstContainer>{}(dst);
+    auto append = [&out](auto&& inner) {
+        using inner_t = decltype(inner);
+        if constexpr(!std::is_lvalue_reference_v<inner_t> &&
+                     is_owning_range_v<remove_cvref_t<inner_t>>) {
+            out = std::copy(std::make_move_iterator(std::begin(inner)),
+                            std::make_move_iterator(std::end(inner)), out);
+        }
+        else {
+            out = std::copy(std::begin(inner), std::end(inner), out);
+        }
+    };
+
+    if constexpr(supports_preallocation_v<DstContainer> &&
+                 !is_std_array_v<inner_result_t> &&
+                 is_sized_v<inner_result_t>) {
+        /* Referenced ranges are collected by address, others by value */
+        constexpr bool by_address = std::is_lvalue_reference_v<inner_ref_t>;
+        using handle_t = std::conditional_t<by_address,
+                                            std::remove_reference_t<inner_ref_t>*,
+                                            inner_result_t>;
+
+        std::vector<handle_t> inners;
+        if constexpr(is_sized_v<remove_cvref_t<SrcContainer>>)
+            inners.reserve(src.size());
+
+        std::size_t n = 0;
+        for(auto&& elem : src) {
+            if constexpr(by_address) {
+                inners.push_back(std::addressof(invoke(elem)));
+                n += static_cast<std::size_t>(inners.back()->size());
+            }
+            else {
+                inners.push_back(invoke(elem));
+                n += static_cast<std::size_t>(inners.back().size());
+            }
+        }
+        dst.reserve(n);
+
+        for(auto& inner : inners) {
+            if constexpr(by_address)
+                append(*inner);
+            else
+                append(std::move(inner));
+        }
+    }
+    else {
+        if constexpr(supports_preallocation_v<DstContainer> &&
+                     is_sized_v<remove_cvref_t<SrcContainer>> &&
+                     is_std_array_v<inner_result_t>) {
+            dst.reserve(src.size() * std::tuple_size_v<inner_result_t>);
+        }
+
+        for(auto&& elem : src) {
+            decltype(auto) inner = invoke(elem);
+            append(std::forward<decltype(inner)>(inner));
+        }
+    }
+    return dst;
+}
+
+#endif
+
+/* Aggregate used for intializing unions without requiring
+ * one of the actual members to be default constructible */
+struct uninitialized_t { };
+
+/* Type used for representing val_ when T is cv void */
+struct void_member_t { };
+
+struct no_init_t {
+    explicit no_init_t() = default;
+};
+
+inline no_init_t constexpr no_init{};
+
+struct internal_expect_t {
+    explicit internal_expect_t() = default;
+};
+
+inline internal_expect_t constexpr internal_expect{};
+
+struct internal_unexpect_t {
+    explicit internal_unexpect_t() = default;
+};
+
+inline internal_unexpect_t constexpr internal_unexpect{};
+
+#ifdef VIEN_EXPECTED_EXTENDED
+/* Invoke g with args adjusted according to the uses-allocator
+ * construction rules for T, i.e. prepended with std::allocator_arg
+ * and alloc, appended with alloc or left as is */
+template <typename T, typename A, typename G, typename... Args>
+void with_uses_allocator_args(A const& alloc, G&& g, Args&&... args) {
+    if constexpr(!std::uses_allocator_v<T,A>) {
+        std::forward<G>(g)(std::forward<Args>(args)...);
+    }
+    else if constexpr(std::is_constructible_v<T, std::allocator_arg_t, A const&, Args&&...>) {
+        std::forward<G>(g)(std::allocator_arg, alloc, std::forward<Args>(args)...);
+    }
+    else {
+        static_assert(std::is_constructible_v<T, Args&&..., A const&>,
+                      "T uses A but is not constructible with it");
+        std::forward<G>(g)(std::forward<Args>(args)..., alloc);
+    }
+}
+#endif
+
+/* expected hierarchy */
+
+/* expected_base */
+/* Provides constexpr default constructor, destructor
+ * and internal storage */
+
+template <typename T, typename E,
+          bool = std::is_trivially_destructible_v<T>,
+          bool = std::is_trivially_destructible_v<E>>
+struct expected_base;
+
+/* Both T and E are trivially destructible, expected should be
+ * trivially destructible */
+template <typename T, typename E>
+struct expected_base<T, E, true, true> {
+
+    constexpr expected_base() : has_val_(true), val_(T()) { }
+    constexpr expected_base(no_init_t) : has_val_{false}, uninitialized_{} { }
+
+    template <typename... Args>
+    constexpr expected_base(internal_expect_t, Args&&... args) noexcept(std::is_nothrow_constructible_v<T, Args&&...>)
+        : has_val_(true), val_(std::forward<Args>(args)...) { }
 
     template <typename Unex = unexpected<E>>
     constexpr expected_base(internal_unexpect_t, Unex&& u) noexcept(std::is_nothrow_constructible_v<unexpected<E>, Unex&&>)
@@ -2124,6 +3106,32 @@ class expected_interface_base : expected_move_assign_base<T,E> {
         constexpr explicit
             expected_interface_base(unexpect_t, std::initializer_list<U> il, Args&&... args);
 
+        #ifdef VIEN_EXPECTED_EXTENDED
+        /* Allocator-extended ctors, T and E are constructed following
+         * the uses-allocator construction rules */
+        template <typename A, typename TT = T,
+                  expected_detail::enable_if_uses_allocator_constructible_t<TT, A>* = nullptr>
+        expected_interface_base(std::allocator_arg_t, A const& alloc);
+
+        template <typename A>
+        expected_interface_base(std::allocator_arg_t, A const& alloc, expected<T,E> const& rhs);
+
+        template <typename A>
+        expected_interface_base(std::allocator_arg_t, A const& alloc, expected<T,E>&& rhs);
+
+        template <typename A, typename G = E,
+                  expected_detail::enable_if_uses_allocator_constructible_t<E, A, G const&>* = nullptr>
+        expected_interface_base(std::allocator_arg_t, A const& alloc, unexpected<G> const& e);
+
+        template <typename A, typename G = E,
+                  expected_detail::enable_if_uses_allocator_constructible_t<E, A, G&&>* = nullptr>
+        expected_interface_base(std::allocator_arg_t, A const& alloc, unexpected<G>&& e);
+
+        template <typename A, typename... Args,
+                  expected_detail::enable_if_uses_allocator_constructible_t<E, A, Args...>* = nullptr>
+        expected_interface_base(std::allocator_arg_t, A const& alloc, unexpect_t, Args&&... args);
+        #endif
+
         template <typename G = E, typename EE = E,
                   expected_detail::expected_enable_unexpected_copy_assignment_t<EE>* = nullptr>
         expected_interface_base& operator=(unexpected<G> const& e);
@@ -2162,6 +3170,14 @@ class expected_interface_base : expected_move_assign_base<T,E> {
         template <typename... Args>
         void store_unexpect(Args&&... args) noexcept(std::is_nothrow_constructible_v<E, Args&&...>);
 
+        #ifdef VIEN_EXPECTED_EXTENDED
+        template <typename A, typename... Args>
+        void store_val_with_alloc(A const& alloc, Args&&... args);
+
+        template <typename A, typename... Args>
+        void store_unexpect_with_alloc(A const& alloc, Args&&... args);
+        #endif
+
         template <typename U = T, typename = std::enable_if_t<!std::is_void_v<U>>>
         constexpr U& internal_get_value() & noexcept;
 
@@ -2220,6 +3236,81 @@ template <typename U, typename... Args,
 constexpr expected_interface_base<T,E>::expected_interface_base(unexpect_t, std::initializer_list<U> il, Args&&... args)
     : base_t(internal_unexpect, il, std::forward<Args>(args)...) { }
 
+#ifdef VIEN_EXPECTED_EXTENDED
+template <typename T, typename E>
+template <typename A, typename TT,
+          expected_detail::enable_if_uses_allocator_constructible_t<TT, A>*>
+expected_interface_base<T,E>::expected_interface_base(std::allocator_arg_t, A const& alloc)
+    : base_t(no_init) {
+    store_val_with_alloc(alloc);
+}
+
+template <typename T, typename E>
+template <typename A>
+expected_interface_base<T,E>::expected_interface_base(std::allocator_arg_t, A const& alloc,
+                                                      expected<T,E> const& rhs)
+    : base_t(no_init) {
+    if constexpr(std::is_void_v<T>) {
+        if(bool(rhs))
+            store_val_with_alloc(alloc);
+        else
+            store_unexpect_with_alloc(alloc, rhs.error());
+    }
+    else {
+        if(bool(rhs))
+            store_val_with_alloc(alloc, *rhs);
+        else
+            store_unexpect_with_alloc(alloc, rhs.error());
+    }
+}
+
+template <typename T, typename E>
+template <typename A>
+expected_interface_base<T,E>::expected_interface_base(std::allocator_arg_t, A const& alloc,
+                                                      expected<T,E>&& rhs)
+    : base_t(no_init) {
+    if constexpr(std::is_void_v<T>) {
+        if(bool(rhs))
+            store_val_with_alloc(alloc);
+        else
+            store_unexpect_with_alloc(alloc, std::move(rhs.error()));
+    }
+    else {
+        if(bool(rhs))
+            store_val_with_alloc(alloc, std::move(*rhs));
+        else
+            store_unexpect_with_alloc(alloc, std::move(rhs.error()));
+    }
+}
+
+template <typename T, typename E>
+template <typename A, typename G,
+          expected_detail::enable_if_uses_allocator_constructible_t<E, A, G const&>*>
+expected_interface_base<T,E>::expected_interface_base(std::allocator_arg_t, A const& alloc,
+                                                      unexpected<G> const& e)
+    : base_t(no_init) {
+    store_unexpect_with_alloc(alloc, e.value());
+}
+
+template <typename T, typename E>
+template <typename A, typename G,
+          expected_detail::enable_if_uses_allocator_constructible_t<E, A, G&&>*>
+expected_interface_base<T,E>::expected_interface_base(std::allocator_arg_t, A const& alloc,
+                                                      unexpected<G>&& e)
+    : base_t(no_init) {
+    store_unexpect_with_alloc(alloc, std::move(e.value()));
+}
+
+template <typename T, typename E>
+template <typename A, typename... Args,
+          expected_detail::enable_if_uses_allocator_constructible_t<E, A, Args...>*>
+expected_interface_base<T,E>::expected_interface_base(std::allocator_arg_t, A const& alloc,
+                                                      unexpect_t, Args&&... args)
+    : base_t(no_init) {
+    store_unexpect_with_alloc(alloc, std::forward<Args>(args)...);
+}
+#endif
+
 template <typename T, typename E>
 template <typename G, typename EE,
           expected_detail::expected_enable_unexpected_copy_assignment_t<EE>*>
@@ -2329,6 +3420,30 @@ void expected_interface_base<T,E>::store_unexpect(Args&&... args) noexcept(std::
     base_t::store_unexpect(std::forward<Args>(args)...);
 }
 
+#ifdef VIEN_EXPECTED_EXTENDED
+template <typename T, typename E>
+template <typename A, typename... Args>
+void expected_interface_base<T,E>::store_val_with_alloc(A const& alloc, Args&&... args) {
+    if constexpr(std::is_void_v<T>) {
+        (void)alloc;
+        base_t::store_val();
+    }
+    else {
+        with_uses_allocator_args<T>(alloc, [this](auto&&... xs) {
+            base_t::store_val(std::forward<decltype(xs)>(xs)...);
+        }, std::forward<Args>(args)...);
+    }
+}
+
+template <typename T, typename E>
+template <typename A, typename... Args>
+void expected_interface_base<T,E>::store_unexpect_with_alloc(A const& alloc, Args&&... args) {
+    with_uses_allocator_args<E>(alloc, [this](auto&&... xs) {
+        base_t::store_unexpect(std::in_place, std::forward<decltype(xs)>(xs)...);
+    }, std::forward<Args>(args)...);
+}
+#endif
+
 template <typename T, typename E>
 template <typename U, typename>
 constexpr U& expected_interface_base<T,E>::internal_get_value() & noexcept {
@@ -2375,6 +3490,15 @@ constexpr unexpected<E> const&& expected_interface_base<T,E>::internal_get_unexp
 
 } /* namespace expected_detail */
 
+#ifdef VIEN_EXPECTED_EXTENDED
+/* Determines the container type produced when map_range and friends
+ * rebind the value_type of Container to T. Specialize for containers
+ * whose template parameters cannot be deduced by expected_detail::rebind */
+template <typename Container, typename T>
+struct container_rebind_traits {
+    using type = expected_detail::rebind_t<Container, T>;
+};
+#endif
 
 /* Primary template (T is not void) */
 template <typename T, typename E>
@@ -2433,6 +3557,16 @@ class expected : public expected_detail::expected_interface_base<T,E> {
                   expected_detail::enable_if_constructible_t<T, std::initializer_list<U>&, Args...>* = nullptr>
         constexpr explicit expected(in_place_t, std::initializer_list<U> il, Args&&... args);
 
+        #ifdef VIEN_EXPECTED_EXTENDED
+        template <typename A, typename U = T, typename TT = T, typename EE = E,
+                  expected_detail::expected_enable_allocator_forwarding_ref_ctor_t<TT, EE, A, U>* = nullptr>
+        expected(std::allocator_arg_t, A const& alloc, U&& v);
+
+        template <typename A, typename... Args,
+                  expected_detail::enable_if_uses_allocator_constructible_t<T, A, Args...>* = nullptr>
+        expected(std::allocator_arg_t, A const& alloc, in_place_t, Args&&... args);
+        #endif
+
         template <typename U = T, typename TT = T, typename EE = E,
                   expected_detail::expected_enable_unary_forwarding_assign_t<TT,EE,U>* = nullptr>
         expected& operator=(U&& v);
@@ -2521,54 +3655,202 @@ class expected : public expected_detail::expected_interface_base<T,E> {
         constexpr expected<expected_detail::rebind_container_t<T,F>, E>
             map_range(F&& f) const &&;
 
-        template <typename F>
-        constexpr expected<T, std::decay_t<std::invoke_result_t<F,E>>>
-            map_error(F&& f) &;
-        template <typename F>
-        constexpr expected<T, std::decay_t<std::invoke_result_t<F,E>>>
-            map_error(F&& f) const &;
-        template <typename F>
-        constexpr expected<T, std::decay_t<std::invoke_result_t<F,E>>>
-            map_error(F&& f) &&;
-        template <typename F>
-        constexpr expected<T, std::decay_t<std::invoke_result_t<F,E>>>
-            map_error(F&& f) const &&;
+        template <typename A, typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr>
+        constexpr expected<expected_detail::rebind_container_t<T,F>, E>
+            map_range(std::allocator_arg_t, A const& alloc, F&& f) &;
 
-        template <typename M, typename F>
-        constexpr T map_or_else(M&& map, F&& fallback) &;
-        template <typename M, typename F>
-        constexpr T map_or_else(M&& map, F&& fallback) const &;
-        template <typename M, typename F>
-        constexpr T map_or_else(M&& map, F&& fallback) &&;
-        template <typename M, typename F>
-        constexpr T map_or_else(M&& map, F&& fallback) const &&;
+        template <typename A, typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr>
+        constexpr expected<expected_detail::rebind_container_t<T,F>, E>
+            map_range(std::allocator_arg_t, A const& alloc, F&& f) const &;
 
-        template <typename F>
-        constexpr expected and_then(F&& f) &;
-        template <typename F>
-        constexpr expected and_then(F&& f) const &;
-        template <typename F>
-        constexpr expected and_then(F&& f) &&;
-        template <typename F>
-        constexpr expected and_then(F&& f) const &&;
+        template <typename A, typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr>
+        constexpr expected<expected_detail::rebind_container_t<T,F>, E>
+            map_range(std::allocator_arg_t, A const& alloc, F&& f) &&;
 
-        template <typename F>
-        constexpr expected or_else(F&& f) &;
-        template <typename F>
-        constexpr expected or_else(F&& f) const &;
-        template <typename F>
-        constexpr expected or_else(F&& f) &&;
-        template <typename F>
-        constexpr expected or_else(F&& f) const &&;
-        #endif
-};
+        template <typename A, typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr>
+        constexpr expected<expected_detail::rebind_container_t<T,F>, E>
+            map_range(std::allocator_arg_t, A const& alloc, F&& f) const &&;
+
+        template <typename OutputIt, typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr,
+                  expected_detail::enable_if_not_container_t<expected_detail::remove_cvref_t<OutputIt>>* = nullptr>
+        constexpr expected<std::decay_t<OutputIt>, E>
+            map_range_into(OutputIt&& out, F&& f) &;
+
+        template <typename OutputIt, typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr,
+                  expected_detail::enable_if_not_container_t<expected_detail::remove_cvref_t<OutputIt>>* = nullptr>
+        constexpr expected<std::decay_t<OutputIt>, E>
+            map_range_into(OutputIt&& out, F&& f) const &;
+
+        template <typename OutputIt, typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr,
+                  expected_detail::enable_if_not_container_t<expected_detail::remove_cvref_t<OutputIt>>* = nullptr>
+        constexpr expected<std::decay_t<OutputIt>, E>
+            map_range_into(OutputIt&& out, F&& f) &&;
+
+        template <typename OutputIt, typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr,
+                  expected_detail::enable_if_not_container_t<expected_detail::remove_cvref_t<OutputIt>>* = nullptr>
+        constexpr expected<std::decay_t<OutputIt>, E>
+            map_range_into(OutputIt&& out, F&& f) const &&;
+
+        template <typename Range, typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr,
+                  expected_detail::enable_if_container_t<expected_detail::remove_cvref_t<Range>>* = nullptr>
+        constexpr expected<std::size_t, E>
+            map_range_into(Range&& dst, F&& f) &;
+
+        template <typename Range, typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr,
+                  expected_detail::enable_if_container_t<expected_detail::remove_cvref_t<Range>>* = nullptr>
+        constexpr expected<std::size_t, E>
+            map_range_into(Range&& dst, F&& f) const &;
+
+        template <typename Range, typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr,
+                  expected_detail::enable_if_container_t<expected_detail::remove_cvref_t<Range>>* = nullptr>
+        constexpr expected<std::size_t, E>
+            map_range_into(Range&& dst, F&& f) &&;
+
+        template <typename Range, typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr,
+                  expected_detail::enable_if_container_t<expected_detail::remove_cvref_t<Range>>* = nullptr>
+        constexpr expected<std::size_t, E>
+            map_range_into(Range&& dst, F&& f) const &&;
 
-template <typename T, typename E>
-template <typename U, typename TT, typename EE,
-          expected_detail::expected_enable_forwarding_ref_ctor_t<TT,EE,U>*,
-          expected_detail::expected_enable_implicit_forwarding_ref_ctor_t<TT,U>*>
-constexpr expected<T,E>::expected(U&& v)
-    : base_t(expected_detail::internal_expect, std::forward<U>(v)) { }
+        template <typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr>
+        expected<expected_detail::flat_rebind_container_t<T,F>, E>
+            flat_map_range(F&& f) &;
+
+        template <typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr>
+        expected<expected_detail::flat_rebind_container_t<T,F>, E>
+            flat_map_range(F&& f) const &;
+
+        template <typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr>
+        expected<expected_detail::flat_rebind_container_t<T,F>, E>
+            flat_map_range(F&& f) &&;
+
+        template <typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr>
+        expected<expected_detail::flat_rebind_container_t<T,F>, E>
+            flat_map_range(F&& f) const &&;
+
+        template <typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr>
+        expected<expected_detail::filter_rebind_container_t<T,F>, E>
+            filter_map_range(F&& f) &;
+
+        template <typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr>
+        expected<expected_detail::filter_rebind_container_t<T,F>, E>
+            filter_map_range(F&& f) const &;
+
+        template <typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr>
+        expected<expected_detail::filter_rebind_container_t<T,F>, E>
+            filter_map_range(F&& f) &&;
+
+        template <typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr>
+        expected<expected_detail::filter_rebind_container_t<T,F>, E>
+            filter_map_range(F&& f) const &&;
+
+        template <typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr>
+        expected<expected_detail::filter_rebind_container_t<T,F>, E>
+            filter_map_range(shrink_to_fit_t, F&& f) &;
+
+        template <typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr>
+        expected<expected_detail::filter_rebind_container_t<T,F>, E>
+            filter_map_range(shrink_to_fit_t, F&& f) const &;
+
+        template <typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr>
+        expected<expected_detail::filter_rebind_container_t<T,F>, E>
+            filter_map_range(shrink_to_fit_t, F&& f) &&;
+
+        template <typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr>
+        expected<expected_detail::filter_rebind_container_t<T,F>, E>
+            filter_map_range(shrink_to_fit_t, F&& f) const &&;
+
+        template <typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr>
+        expected<expected_detail::rebind_container_t<T,F>, E>
+            try_map_range(F&& f) &;
+
+        template <typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr>
+        expected<expected_detail::rebind_container_t<T,F>, E>
+            try_map_range(F&& f) const &;
+
+        template <typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr>
+        expected<expected_detail::rebind_container_t<T,F>, E>
+            try_map_range(F&& f) &&;
+
+        template <typename F, typename TT = T,
+                  expected_detail::enable_if_container_t<TT>* = nullptr>
+        expected<expected_detail::rebind_container_t<T,F>, E>
+            try_map_range(F&& f) const &&;
+
+        template <typename F>
+        constexpr expected<T, std::decay_t<std::invoke_result_t<F,E>>>
+            map_error(F&& f) &;
+        template <typename F>
+        constexpr expected<T, std::decay_t<std::invoke_result_t<F,E>>>
+            map_error(F&& f) const &;
+        template <typename F>
+        constexpr expected<T, std::decay_t<std::invoke_result_t<F,E>>>
+            map_error(F&& f) &&;
+        template <typename F>
+        constexpr expected<T, std::decay_t<std::invoke_result_t<F,E>>>
+            map_error(F&& f) const &&;
+
+        template <typename M, typename F>
+        constexpr T map_or_else(M&& map, F&& fallback) &;
+        template <typename M, typename F>
+        constexpr T map_or_else(M&& map, F&& fallback) const &;
+        template <typename M, typename F>
+        constexpr T map_or_else(M&& map, F&& fallback) &&;
+        template <typename M, typename F>
+        constexpr T map_or_else(M&& map, F&& fallback) const &&;
+
+        template <typename F>
+        constexpr expected and_then(F&& f) &;
+        template <typename F>
+        constexpr expected and_then(F&& f) const &;
+        template <typename F>
+        constexpr expected and_then(F&& f) &&;
+        template <typename F>
+        constexpr expected and_then(F&& f) const &&;
+
+        template <typename F>
+        constexpr expected or_else(F&& f) &;
+        template <typename F>
+        constexpr expected or_else(F&& f) const &;
+        template <typename F>
+        constexpr expected or_else(F&& f) &&;
+        template <typename F>
+        constexpr expected or_else(F&& f) const &&;
+        #endif
+};
+
+template <typename T, typename E>
+template <typename U, typename TT, typename EE,
+          expected_detail::expected_enable_forwarding_ref_ctor_t<TT,EE,U>*,
+          expected_detail::expected_enable_implicit_forwarding_ref_ctor_t<TT,U>*>
+constexpr expected<T,E>::expected(U&& v)
+    : base_t(expected_detail::internal_expect, std::forward<U>(v)) { }
 
 template <typename T, typename E>
 template <typename U, typename TT, typename EE,
@@ -2634,6 +3916,24 @@ template <typename U, typename... Args,
 constexpr expected<T,E>::expected(in_place_t, std::initializer_list<U> il, Args&&... args)
     : base_t(expected_detail::internal_expect, il, std::forward<Args>(args)...) { }
 
+#ifdef VIEN_EXPECTED_EXTENDED
+template <typename T, typename E>
+template <typename A, typename U, typename TT, typename EE,
+          expected_detail::expected_enable_allocator_forwarding_ref_ctor_t<TT, EE, A, U>*>
+expected<T,E>::expected(std::allocator_arg_t, A const& alloc, U&& v)
+    : base_t(expected_detail::no_init) {
+    this->store_val_with_alloc(alloc, std::forward<U>(v));
+}
+
+template <typename T, typename E>
+template <typename A, typename... Args,
+          expected_detail::enable_if_uses_allocator_constructible_t<T, A, Args...>*>
+expected<T,E>::expected(std::allocator_arg_t, A const& alloc, in_place_t, Args&&... args)
+    : base_t(expected_detail::no_init) {
+    this->store_val_with_alloc(alloc, std::forward<Args>(args)...);
+}
+#endif
+
 template <typename T, typename E>
 template <typename U, typename TT, typename EE,
           expected_detail::expected_enable_unary_forwarding_assign_t<TT,EE,U>*>
@@ -3004,7 +4304,7 @@ constexpr expected<expected_detail::rebind_container_t<T,F>, E>
 expected<T,E>::map_range(F&& f) & {
     using invoke_t =
         std::decay_t<std::invoke_result_t<F, expected_detail::value_type_of_t<T>>>;
-    using container_t = expected_detail::rebind_t<T, invoke_t>;
+    using container_t = expected_detail::container_rebind_t<T, invoke_t>;
 
     using result_t = expected<container_t, E>;
 
@@ -3023,42 +4323,555 @@ constexpr expected<expected_detail::rebind_container_t<T,F>, E>
 expected<T,E>::map_range(F&& f) const & {
     using invoke_t =
         std::decay_t<std::invoke_result_t<F, expected_detail::value_type_of_t<T>>>;
-    using container_t = expected_detail::rebind_t<T, invoke_t>;
+    using container_t = expected_detail::container_rebind_t<T, invoke_t>;
 
     using result_t = expected<container_t, E>;
 
     if(!bool(*this))
         return result_t(unexpect, this->error());
 
-    return result_t(expected_detail::convert<T, container_t, F, invoke_t>
-                        {}(**this, std::forward<F>(f)));
+    return result_t(expected_detail::convert<T, container_t, F, invoke_t>
+                        {}(**this, std::forward<F>(f)));
+}
+
+template <typename T, typename E>
+template <typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*>
+[[nodiscard]]
+constexpr expected<expected_detail::rebind_container_t<T,F>, E>
+expected<T,E>::map_range(F&& f) && {
+    using invoke_t =
+        std::decay_t<std::invoke_result_t<F, expected_detail::value_type_of_t<T>>>;
+    using container_t = expected_detail::container_rebind_t<T, invoke_t>;
+
+    using result_t = expected<container_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, std::move(this->error()));
+
+    /* T and container_t are the same, transform **this and move
+     * **this to new instance */
+    if constexpr(std::is_same_v<T, container_t>) {
+        expected_detail::convert<T, container_t, F, invoke_t>
+            {}(expected_detail::in_place, **this, std::forward<F>(f));
+        return result_t(std::move(**this));
+    }
+    /* T and container_t are not the same, must create new container */
+    else {
+        return result_t(expected_detail::convert<T, container_t, F, invoke_t>
+                            {}(**this, std::forward<F>(f)));
+    }
+}
+
+template <typename T, typename E>
+template <typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*>
+[[nodiscard]]
+constexpr expected<expected_detail::rebind_container_t<T,F>, E>
+expected<T,E>::map_range(F&& f) const && {
+    using invoke_t =
+        std::decay_t<std::invoke_result_t<F, expected_detail::value_type_of_t<T>>>;
+    using container_t = expected_detail::container_rebind_t<T, invoke_t>;
+
+    using result_t = expected<container_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, std::move(this->error()));
+
+    if constexpr(std::is_same_v<T, container_t>) {
+        return result_t(expected_detail::convert<T, container_t, F, invoke_t>
+                            {}(expected_detail::in_place, **this, std::forward<F>(f)));
+    }
+    else {
+        return result_t(expected_detail::convert<T, container_t, F, invoke_t>
+                            {}(**this, std::forward<F>(f)));
+    }
+}
+
+template <typename T, typename E>
+template <typename A, typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*>
+[[nodiscard]]
+constexpr expected<expected_detail::rebind_container_t<T,F>, E>
+expected<T,E>::map_range(std::allocator_arg_t, A const& alloc, F&& f) & {
+    using invoke_t =
+        std::decay_t<std::invoke_result_t<F, expected_detail::value_type_of_t<T>>>;
+    using container_t = expected_detail::container_rebind_t<T, invoke_t>;
+    static_assert(expected_detail::constructible_with_allocator_v<container_t, A>,
+                  "Container cannot be constructed from the allocator");
+
+    using result_t = expected<container_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, this->error());
+
+    return result_t(expected_detail::convert<T, container_t, F, invoke_t>
+                        {}(expected_detail::make_with_allocator<container_t>(alloc),
+                           **this, std::forward<F>(f)));
+}
+
+template <typename T, typename E>
+template <typename A, typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*>
+[[nodiscard]]
+constexpr expected<expected_detail::rebind_container_t<T,F>, E>
+expected<T,E>::map_range(std::allocator_arg_t, A const& alloc, F&& f) const & {
+    using invoke_t =
+        std::decay_t<std::invoke_result_t<F, expected_detail::value_type_of_t<T>>>;
+    using container_t = expected_detail::container_rebind_t<T, invoke_t>;
+    static_assert(expected_detail::constructible_with_allocator_v<container_t, A>,
+                  "Container cannot be constructed from the allocator");
+
+    using result_t = expected<container_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, this->error());
+
+    return result_t(expected_detail::convert<T, container_t, F, invoke_t>
+                        {}(expected_detail::make_with_allocator<container_t>(alloc),
+                           **this, std::forward<F>(f)));
+}
+
+template <typename T, typename E>
+template <typename A, typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*>
+[[nodiscard]]
+constexpr expected<expected_detail::rebind_container_t<T,F>, E>
+expected<T,E>::map_range(std::allocator_arg_t, A const& alloc, F&& f) && {
+    using invoke_t =
+        std::decay_t<std::invoke_result_t<F, expected_detail::value_type_of_t<T>>>;
+    using container_t = expected_detail::container_rebind_t<T, invoke_t>;
+    static_assert(expected_detail::constructible_with_allocator_v<container_t, A>,
+                  "Container cannot be constructed from the allocator");
+
+    using result_t = expected<container_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, std::move(this->error()));
+
+    return result_t(expected_detail::convert<T, container_t, F, invoke_t>
+                        {}(expected_detail::make_with_allocator<container_t>(alloc),
+                           **this, std::forward<F>(f)));
+}
+
+template <typename T, typename E>
+template <typename A, typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*>
+[[nodiscard]]
+constexpr expected<expected_detail::rebind_container_t<T,F>, E>
+expected<T,E>::map_range(std::allocator_arg_t, A const& alloc, F&& f) const && {
+    using invoke_t =
+        std::decay_t<std::invoke_result_t<F, expected_detail::value_type_of_t<T>>>;
+    using container_t = expected_detail::container_rebind_t<T, invoke_t>;
+    static_assert(expected_detail::constructible_with_allocator_v<container_t, A>,
+                  "Container cannot be constructed from the allocator");
+
+    using result_t = expected<container_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, std::move(this->error()));
+
+    return result_t(expected_detail::convert<T, container_t, F, invoke_t>
+                        {}(expected_detail::make_with_allocator<container_t>(alloc),
+                           **this, std::forward<F>(f)));
+}
+
+template <typename T, typename E>
+template <typename OutputIt, typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*,
+          expected_detail::enable_if_not_container_t<expected_detail::remove_cvref_t<OutputIt>>*>
+[[nodiscard]]
+constexpr expected<std::decay_t<OutputIt>, E>
+expected<T,E>::map_range_into(OutputIt&& out, F&& f) & {
+    using result_t = expected<std::decay_t<OutputIt>, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, this->error());
+
+    return result_t(expected_detail::transform_into(**this, std::forward<OutputIt>(out),
+                                                    std::forward<F>(f)));
+}
+
+template <typename T, typename E>
+template <typename OutputIt, typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*,
+          expected_detail::enable_if_not_container_t<expected_detail::remove_cvref_t<OutputIt>>*>
+[[nodiscard]]
+constexpr expected<std::decay_t<OutputIt>, E>
+expected<T,E>::map_range_into(OutputIt&& out, F&& f) const & {
+    using result_t = expected<std::decay_t<OutputIt>, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, this->error());
+
+    return result_t(expected_detail::transform_into(**this, std::forward<OutputIt>(out),
+                                                    std::forward<F>(f)));
+}
+
+template <typename T, typename E>
+template <typename OutputIt, typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*,
+          expected_detail::enable_if_not_container_t<expected_detail::remove_cvref_t<OutputIt>>*>
+[[nodiscard]]
+constexpr expected<std::decay_t<OutputIt>, E>
+expected<T,E>::map_range_into(OutputIt&& out, F&& f) && {
+    using result_t = expected<std::decay_t<OutputIt>, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, std::move(this->error()));
+
+    /* Elements are moved into f */
+    return result_t(expected_detail::transform_into(std::move(**this), std::forward<OutputIt>(out),
+                                                    std::forward<F>(f)));
+}
+
+template <typename T, typename E>
+template <typename OutputIt, typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*,
+          expected_detail::enable_if_not_container_t<expected_detail::remove_cvref_t<OutputIt>>*>
+[[nodiscard]]
+constexpr expected<std::decay_t<OutputIt>, E>
+expected<T,E>::map_range_into(OutputIt&& out, F&& f) const && {
+    using result_t = expected<std::decay_t<OutputIt>, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, std::move(this->error()));
+
+    return result_t(expected_detail::transform_into(std::move(**this), std::forward<OutputIt>(out),
+                                                    std::forward<F>(f)));
+}
+
+template <typename T, typename E>
+template <typename Range, typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*,
+          expected_detail::enable_if_container_t<expected_detail::remove_cvref_t<Range>>*>
+[[nodiscard]]
+constexpr expected<std::size_t, E>
+expected<T,E>::map_range_into(Range&& dst, F&& f) & {
+    using result_t = expected<std::size_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, this->error());
+
+    return result_t(expected_detail::transform_into_range(**this, std::forward<Range>(dst),
+                                                          std::forward<F>(f)));
+}
+
+template <typename T, typename E>
+template <typename Range, typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*,
+          expected_detail::enable_if_container_t<expected_detail::remove_cvref_t<Range>>*>
+[[nodiscard]]
+constexpr expected<std::size_t, E>
+expected<T,E>::map_range_into(Range&& dst, F&& f) const & {
+    using result_t = expected<std::size_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, this->error());
+
+    return result_t(expected_detail::transform_into_range(**this, std::forward<Range>(dst),
+                                                          std::forward<F>(f)));
+}
+
+template <typename T, typename E>
+template <typename Range, typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*,
+          expected_detail::enable_if_container_t<expected_detail::remove_cvref_t<Range>>*>
+[[nodiscard]]
+constexpr expected<std::size_t, E>
+expected<T,E>::map_range_into(Range&& dst, F&& f) && {
+    using result_t = expected<std::size_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, std::move(this->error()));
+
+    /* Elements are moved into f */
+    return result_t(expected_detail::transform_into_range(std::move(**this), std::forward<Range>(dst),
+                                                          std::forward<F>(f)));
+}
+
+template <typename T, typename E>
+template <typename Range, typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*,
+          expected_detail::enable_if_container_t<expected_detail::remove_cvref_t<Range>>*>
+[[nodiscard]]
+constexpr expected<std::size_t, E>
+expected<T,E>::map_range_into(Range&& dst, F&& f) const && {
+    using result_t = expected<std::size_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, std::move(this->error()));
+
+    return result_t(expected_detail::transform_into_range(std::move(**this), std::forward<Range>(dst),
+                                                          std::forward<F>(f)));
+}
+
+template <typename T, typename E>
+template <typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*>
+[[nodiscard]]
+expected<expected_detail::flat_rebind_container_t<T,F>, E>
+expected<T,E>::flat_map_range(F&& f) & {
+    using container_t = expected_detail::flat_rebind_container_t<T,F>;
+    using result_t = expected<container_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, this->error());
+
+    return result_t(expected_detail::flatten<container_t>(**this, std::forward<F>(f)));
+}
+
+template <typename T, typename E>
+template <typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*>
+[[nodiscard]]
+expected<expected_detail::flat_rebind_container_t<T,F>, E>
+expected<T,E>::flat_map_range(F&& f) const & {
+    using container_t = expected_detail::flat_rebind_container_t<T,F>;
+    using result_t = expected<container_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, this->error());
+
+    return result_t(expected_detail::flatten<container_t>(**this, std::forward<F>(f)));
+}
+
+template <typename T, typename E>
+template <typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*>
+[[nodiscard]]
+expected<expected_detail::flat_rebind_container_t<T,F>, E>
+expected<T,E>::flat_map_range(F&& f) && {
+    using container_t = expected_detail::flat_rebind_container_t<T,F>;
+    using result_t = expected<container_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, std::move(this->error()));
+
+    /* Elements are moved into f */
+    return result_t(expected_detail::flatten<container_t>(std::move(**this), std::forward<F>(f)));
+}
+
+template <typename T, typename E>
+template <typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*>
+[[nodiscard]]
+expected<expected_detail::flat_rebind_container_t<T,F>, E>
+expected<T,E>::flat_map_range(F&& f) const && {
+    using container_t = expected_detail::flat_rebind_container_t<T,F>;
+    using result_t = expected<container_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, std::move(this->error()));
+
+    return result_t(expected_detail::flatten<container_t>(std::move(**this), std::forward<F>(f)));
+}
+
+template <typename T, typename E>
+template <typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*>
+[[nodiscard]]
+expected<expected_detail::filter_rebind_container_t<T,F>, E>
+expected<T,E>::filter_map_range(F&& f) & {
+    using container_t = expected_detail::filter_rebind_container_t<T,F>;
+    using result_t = expected<container_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, this->error());
+
+    return result_t(expected_detail::filter_convert<container_t>(**this, std::forward<F>(f), false));
+}
+
+template <typename T, typename E>
+template <typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*>
+[[nodiscard]]
+expected<expected_detail::filter_rebind_container_t<T,F>, E>
+expected<T,E>::filter_map_range(F&& f) const & {
+    using container_t = expected_detail::filter_rebind_container_t<T,F>;
+    using result_t = expected<container_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, this->error());
+
+    return result_t(expected_detail::filter_convert<container_t>(**this, std::forward<F>(f), false));
+}
+
+template <typename T, typename E>
+template <typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*>
+[[nodiscard]]
+expected<expected_detail::filter_rebind_container_t<T,F>, E>
+expected<T,E>::filter_map_range(F&& f) && {
+    using container_t = expected_detail::filter_rebind_container_t<T,F>;
+    using result_t = expected<container_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, std::move(this->error()));
+
+    /* Elements are moved into f */
+    return result_t(expected_detail::filter_convert<container_t>(std::move(**this), std::forward<F>(f), false));
+}
+
+template <typename T, typename E>
+template <typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*>
+[[nodiscard]]
+expected<expected_detail::filter_rebind_container_t<T,F>, E>
+expected<T,E>::filter_map_range(F&& f) const && {
+    using container_t = expected_detail::filter_rebind_container_t<T,F>;
+    using result_t = expected<container_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, std::move(this->error()));
+
+    return result_t(expected_detail::filter_convert<container_t>(std::move(**this), std::forward<F>(f), false));
+}
+
+template <typename T, typename E>
+template <typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*>
+[[nodiscard]]
+expected<expected_detail::filter_rebind_container_t<T,F>, E>
+expected<T,E>::filter_map_range(shrink_to_fit_t, F&& f) & {
+    using container_t = expected_detail::filter_rebind_container_t<T,F>;
+    using result_t = expected<container_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, this->error());
+
+    return result_t(expected_detail::filter_convert<container_t>(**this, std::forward<F>(f), true));
+}
+
+template <typename T, typename E>
+template <typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*>
+[[nodiscard]]
+expected<expected_detail::filter_rebind_container_t<T,F>, E>
+expected<T,E>::filter_map_range(shrink_to_fit_t, F&& f) const & {
+    using container_t = expected_detail::filter_rebind_container_t<T,F>;
+    using result_t = expected<container_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, this->error());
+
+    return result_t(expected_detail::filter_convert<container_t>(**this, std::forward<F>(f), true));
+}
+
+template <typename T, typename E>
+template <typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*>
+[[nodiscard]]
+expected<expected_detail::filter_rebind_container_t<T,F>, E>
+expected<T,E>::filter_map_range(shrink_to_fit_t, F&& f) && {
+    using container_t = expected_detail::filter_rebind_container_t<T,F>;
+    using result_t = expected<container_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, std::move(this->error()));
+
+    /* Elements are moved into f */
+    return result_t(expected_detail::filter_convert<container_t>(std::move(**this), std::forward<F>(f), true));
+}
+
+template <typename T, typename E>
+template <typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*>
+[[nodiscard]]
+expected<expected_detail::filter_rebind_container_t<T,F>, E>
+expected<T,E>::filter_map_range(shrink_to_fit_t, F&& f) const && {
+    using container_t = expected_detail::filter_rebind_container_t<T,F>;
+    using result_t = expected<container_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, std::move(this->error()));
+
+    return result_t(expected_detail::filter_convert<container_t>(std::move(**this), std::forward<F>(f), true));
+}
+
+template <typename T, typename E>
+template <typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*>
+[[nodiscard]]
+expected<expected_detail::rebind_container_t<T,F>, E>
+expected<T,E>::try_map_range(F&& f) & {
+    static_assert(std::is_constructible_v<E, alloc_error>,
+                  "E must be constructible from alloc_error");
+    using invoke_t =
+        std::decay_t<std::invoke_result_t<F, expected_detail::value_type_of_t<T>>>;
+    using container_t = expected_detail::container_rebind_t<T, invoke_t>;
+
+    using result_t = expected<container_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, this->error());
+
+    auto res = expected_detail::try_convert<T, container_t, F, invoke_t>(**this, std::forward<F>(f));
+    if(!res)
+        return result_t(unexpect, std::move(res.error()));
+
+    return result_t(std::move(*res));
+}
+
+template <typename T, typename E>
+template <typename F, typename TT,
+          expected_detail::enable_if_container_t<TT>*>
+[[nodiscard]]
+expected<expected_detail::rebind_container_t<T,F>, E>
+expected<T,E>::try_map_range(F&& f) const & {
+    static_assert(std::is_constructible_v<E, alloc_error>,
+                  "E must be constructible from alloc_error");
+    using invoke_t =
+        std::decay_t<std::invoke_result_t<F, expected_detail::value_type_of_t<T>>>;
+    using container_t = expected_detail::container_rebind_t<T, invoke_t>;
+
+    using result_t = expected<container_t, E>;
+
+    if(!bool(*this))
+        return result_t(unexpect, this->error());
+
+    auto res = expected_detail::try_convert<T, container_t, F, invoke_t>(**this, std::forward<F>(f));
+    if(!res)
+        return result_t(unexpect, std::move(res.error()));
+
+    return result_t(std::move(*res));
 }
 
 template <typename T, typename E>
 template <typename F, typename TT,
           expected_detail::enable_if_container_t<TT>*>
 [[nodiscard]]
-constexpr expected<expected_detail::rebind_container_t<T,F>, E>
-expected<T,E>::map_range(F&& f) && {
+expected<expected_detail::rebind_container_t<T,F>, E>
+expected<T,E>::try_map_range(F&& f) && {
+    static_assert(std::is_constructible_v<E, alloc_error>,
+                  "E must be constructible from alloc_error");
     using invoke_t =
         std::decay_t<std::invoke_result_t<F, expected_detail::value_type_of_t<T>>>;
-    using container_t = expected_detail::rebind_t<T, invoke_t>;
+    using container_t = expected_detail::container_rebind_t<T, invoke_t>;
 
     using result_t = expected<container_t, E>;
 
     if(!bool(*this))
         return result_t(unexpect, std::move(this->error()));
 
-    /* T and container_t are the same, transform **this and move
-     * **this to new instance */
+    /* T and container_t are the same, transform **this in place. Only
+     * the elements may allocate */
     if constexpr(std::is_same_v<T, container_t>) {
-        return result_t(expected_detail::convert<T, container_t, F, invoke_t>
-                            {}(expected_detail::in_place, **this, std::forward<F>(f)));
+        try {
+            expected_detail::convert<T, container_t, F, invoke_t>
+                {}(expected_detail::in_place, **this, std::forward<F>(f));
+        }
+        catch(std::bad_alloc const&) {
+            return result_t(unexpect, alloc_error{0u});
+        }
+        return result_t(std::move(**this));
     }
-    /* T and container_t are not the same, must create new container */
     else {
-        return result_t(expected_detail::convert<T, container_t, F, invoke_t>
-                            {}(**this, std::forward<F>(f)));
+        auto res = expected_detail::try_convert<T, container_t, F, invoke_t>(**this, std::forward<F>(f));
+        if(!res)
+            return result_t(unexpect, std::move(res.error()));
+
+        return result_t(std::move(*res));
     }
 }
 
@@ -3066,25 +4879,24 @@ template <typename T, typename E>
 template <typename F, typename TT,
           expected_detail::enable_if_container_t<TT>*>
 [[nodiscard]]
-constexpr expected<expected_detail::rebind_container_t<T,F>, E>
-expected<T,E>::map_range(F&& f) const && {
+expected<expected_detail::rebind_container_t<T,F>, E>
+expected<T,E>::try_map_range(F&& f) const && {
+    static_assert(std::is_constructible_v<E, alloc_error>,
+                  "E must be constructible from alloc_error");
     using invoke_t =
         std::decay_t<std::invoke_result_t<F, expected_detail::value_type_of_t<T>>>;
-    using container_t = expected_detail::rebind_t<T, invoke_t>;
+    using container_t = expected_detail::container_rebind_t<T, invoke_t>;
 
     using result_t = expected<container_t, E>;
 
     if(!bool(*this))
         return result_t(unexpect, std::move(this->error()));
 
-    if constexpr(std::is_same_v<T, container_t>) {
-        return result_t(expected_detail::convert<T, container_t, F, invoke_t>
-                            {}(expected_detail::in_place, **this, std::forward<F>(f)));
-    }
-    else {
-        return result_t(expected_detail::convert<T, container_t, F, invoke_t>
-                            {}(**this, std::forward<F>(f)));
-    }
+    auto res = expected_detail::try_convert<T, container_t, F, invoke_t>(**this, std::forward<F>(f));
+    if(!res)
+        return result_t(unexpect, std::move(res.error()));
+
+    return result_t(std::move(*res));
 }
 
 template <typename T, typename E>
@@ -3957,6 +5769,639 @@ char const* bad_expected_access<E>::what() const noexcept {
     return "Attempt to access expected without value\n";
 }
 
+#ifdef VIEN_EXPECTED_EXTENDED
+/* Marks a callable as pure, i.e. its result depends only on its
+ * arguments and invoking it has no observable side effects. Allows
+ * map_range to invoke it fewer times than there are elements */
+template <typename F>
+class pure_fn {
+    public:
+        constexpr explicit pure_fn(F f) : f_(std::move(f)) { }
+
+        template <typename... Args>
+        constexpr std::invoke_result_t<F&, Args...> operator()(Args&&... args) & {
+            return std::invoke(f_, std::forward<Args>(args)...);
+        }
+
+        template <typename... Args>
+        constexpr std::invoke_result_t<F const&, Args...> operator()(Args&&... args) const & {
+            return std::invoke(f_, std::forward<Args>(args)...);
+        }
+
+    private:
+        F f_;
+};
+
+template <typename F>
+constexpr pure_fn<std::decay_t<F>> pure(F&& f) {
+    return pure_fn<std::decay_t<F>>(std::forward<F>(f));
+}
+
+/* Allocate and construct an instance of T. Allocation failure, including
+ * std::bad_alloc thrown by T's constructor, is reported as alloc_error */
+template <typename T, typename... Args>
+expected<std::unique_ptr<T>, alloc_error> try_make_unique(Args&&... args) {
+    try {
+        T* p = new (std::nothrow) T(std::forward<Args>(args)...);
+        if(!p)
+            return unexpected(alloc_error{sizeof(T)});
+        return std::unique_ptr<T>(p);
+    }
+    catch(std::bad_alloc const&) {
+        return unexpected(alloc_error{sizeof(T)});
+    }
+}
+
+/* Allocate storage for n objects using alloc */
+template <typename A>
+expected<typename std::allocator_traits<A>::pointer, alloc_error> try_allocate(A& alloc, std::size_t n) {
+    using traits_t = std::allocator_traits<A>;
+    try {
+        return traits_t::allocate(alloc, n);
+    }
+    catch(std::bad_alloc const&) {
+        return unexpected(alloc_error{n * sizeof(typename traits_t::value_type)});
+    }
+}
+
+/* Turn the expecteds in [first, last) into a single expected holding a
+ * Container of their values, or the first error encountered. Random
+ * access ranges are preallocated */
+template <typename Container, typename InputIt>
+expected<Container, typename std::iterator_traits<InputIt>::value_type::error_type>
+collect(InputIt first, InputIt last) {
+    using category_t = typename std::iterator_traits<InputIt>::iterator_category;
+    std::size_t n = 0u;
+    if constexpr(std::is_base_of_v<std::random_access_iterator_tag, category_t>)
+        n = static_cast<std::size_t>(std::distance(first, last));
+
+    return expected_detail::collect_n<Container>(first, last, n);
+}
+
+/* Range overload of collect. Sized ranges are preallocated and the
+ * values are moved out of rvalue ranges */
+template <typename Container, typename Range,
+          expected_detail::enable_if_container_t<expected_detail::remove_cvref_t<Range>>* = nullptr>
+auto collect(Range&& r) {
+    std::size_t n = 0u;
+    if constexpr(expected_detail::is_sized_v<expected_detail::remove_cvref_t<Range>>)
+        n = r.size();
+
+    if constexpr(std::is_lvalue_reference_v<Range>)
+        return expected_detail::collect_n<Container>(std::begin(r), std::end(r), n);
+    else
+        return expected_detail::collect_n<Container>(std::make_move_iterator(std::begin(r)),
+                                                     std::make_move_iterator(std::end(r)), n);
+}
+
+/* Move, or copy if r is an lvalue, the values in r to value_out and the
+ * errors to error_out in a single pass. The destinations are either
+ * containers or output iterators. The value container is preallocated
+ * if r is sized */
+template <typename Range, typename ValueOut, typename ErrorOut,
+          expected_detail::enable_if_container_t<expected_detail::remove_cvref_t<Range>>* = nullptr>
+partition_counts partition_results(Range&& r, ValueOut&& value_out, ErrorOut&& error_out) {
+    return expected_detail::partition_results<false>(std::forward<Range>(r),
+                                                     std::forward<ValueOut>(value_out),
+                                                     std::forward<ErrorOut>(error_out));
+}
+
+/* As partition_results, but writes std::pair<std::size_t, T> and
+ * std::pair<std::size_t, E>, where the first member is the position
+ * of the element in r */
+template <typename Range, typename ValueOut, typename ErrorOut,
+          expected_detail::enable_if_container_t<expected_detail::remove_cvref_t<Range>>* = nullptr>
+partition_counts partition_results_indexed(Range&& r, ValueOut&& value_out, ErrorOut&& error_out) {
+    return expected_detail::partition_results<true>(std::forward<Range>(r),
+                                                    std::forward<ValueOut>(value_out),
+                                                    std::forward<ErrorOut>(error_out));
+}
+
+/* Reduce the values produced by invoking transform on each element of r,
+ * starting from init. transform must return an expected. Stops at, and
+ * returns, the first error */
+template <typename Range, typename T, typename Reduce, typename Transform,
+          expected_detail::enable_if_container_t<expected_detail::remove_cvref_t<Range>>* = nullptr>
+auto try_transform_reduce(Range&& r, T init, Reduce reduce, Transform transform) {
+    using transformed_t = expected_detail::remove_cvref_t<
+        std::invoke_result_t<Transform&, decltype(*std::begin(r))>>;
+    static_assert(expected_detail::is_expected_v<transformed_t>, "Transform must return an expected");
+    using result_t = expected<T, typename transformed_t::error_type>;
+
+    for(auto&& elem : r) {
+        auto res = std::invoke(transform, std::forward<decltype(elem)>(elem));
+        if(!bool(res))
+            return result_t(unexpect, std::move(res).error());
+        init = std::invoke(reduce, std::move(init), *std::move(res));
+    }
+    return result_t(std::in_place, std::move(init));
+}
+
+/* Contiguous list of errors storing up to N elements inline. Elements are
+ * moved to the heap once more than N have been added */
+template <typename E, std::size_t N = 4>
+class accumulating {
+    static_assert(N > 0u, "Inline capacity must be non-zero");
+
+    public:
+        using value_type = E;
+        using size_type = std::size_t;
+        using iterator = E*;
+        using const_iterator = E const*;
+
+        accumulating() noexcept : size_{0u}, on_heap_{false}, buf_{}, heap_{} { }
+
+        accumulating(accumulating const& other)
+            : size_{0u}, on_heap_{other.on_heap_}, buf_{}, heap_{} {
+            if(on_heap_)
+                heap_ = other.heap_;
+            else
+                copy_inline(other.begin(), other.end());
+        }
+
+        accumulating(accumulating&& other) noexcept(std::is_nothrow_move_constructible_v<E>)
+            : size_{0u}, on_heap_{other.on_heap_}, buf_{}, heap_{std::move(other.heap_)} {
+            if(!on_heap_)
+                copy_inline(std::make_move_iterator(other.begin()),
+                            std::make_move_iterator(other.end()));
+            other.clear();
+        }
+
+        accumulating& operator=(accumulating const& other) {
+            if(this != &other) {
+                clear();
+                if(other.on_heap_) {
+                    heap_ = other.heap_;
+                    on_heap_ = true;
+                }
+                else {
+                    copy_inline(other.begin(), other.end());
+                }
+            }
+            return *this;
+        }
+
+        accumulating& operator=(accumulating&& other) noexcept(std::is_nothrow_move_constructible_v<E>) {
+            if(this != &other) {
+                clear();
+                if(other.on_heap_) {
+                    heap_ = std::move(other.heap_);
+                    on_heap_ = true;
+                }
+                else {
+                    copy_inline(std::make_move_iterator(other.begin()),
+                                std::make_move_iterator(other.end()));
+                }
+                other.clear();
+            }
+            return *this;
+        }
+
+        ~accumulating() {
+            destroy_inline();
+        }
+
+        void push_back(E const& e) {
+            emplace_back(e);
+        }
+
+        void push_back(E&& e) {
+            emplace_back(std::move(e));
+        }
+
+        template <typename... Args>
+        E& emplace_back(Args&&... args) {
+            if(on_heap_)
+                return heap_.emplace_back(std::forward<Args>(args)...);
+
+            if(size_ < N) {
+                E* p = ::new (static_cast<void*>(buf_.elems + size_)) E(std::forward<Args>(args)...);
+                ++size_;
+                return *p;
+            }
+
+            /* args may refer to an inline element */
+            E tmp(std::forward<Args>(args)...);
+            spill();
+            return heap_.emplace_back(std::move(tmp));
+        }
+
+        void clear() noexcept {
+            destroy_inline();
+            heap_.clear();
+            on_heap_ = false;
+        }
+
+        E* data() noexcept {
+            return on_heap_ ? heap_.data() : buf_.elems;
+        }
+
+        E const* data() const noexcept {
+            return on_heap_ ? heap_.data() : buf_.elems;
+        }
+
+        std::size_t size() const noexcept {
+            return on_heap_ ? heap_.size() : size_;
+        }
+
+        bool empty() const noexcept {
+            return size() == 0u;
+        }
+
+        E& operator[](std::size_t i) noexcept {
+            return data()[i];
+        }
+
+        E const& operator[](std::size_t i) const noexcept {
+            return data()[i];
+        }
+
+        iterator begin() noexcept {
+            return data();
+        }
+
+        const_iterator begin() const noexcept {
+            return data();
+        }
+
+        iterator end() noexcept {
+            return data() + size();
+        }
+
+        const_iterator end() const noexcept {
+            return data() + size();
+        }
+
+    private:
+        /* Construct inline elements from [first, last), which must
+         * not hold more than N elements */
+        template <typename InputIt>
+        void copy_inline(InputIt first, InputIt last) {
+            try {
+                for(; first != last; ++first) {
+                    ::new (static_cast<void*>(buf_.elems + size_)) E(*first);
+                    ++size_;
+                }
+            }
+            catch(...) {
+                destroy_inline();
+                throw;
+            }
+        }
+
+        /* Move the inline elements to the heap */
+        void spill() {
+            heap_.reserve(2u * N);
+            try {
+                for(std::size_t i = 0u; i < size_; ++i)
+                    heap_.push_back(std::move_if_noexcept(buf_.elems[i]));
+            }
+            catch(...) {
+                heap_.clear();
+                throw;
+            }
+            destroy_inline();
+            on_heap_ = true;
+        }
+
+        void destroy_inline() noexcept {
+            for(std::size_t i = 0u; i < size_; ++i)
+                buf_.elems[i].~E();
+            size_ = 0u;
+        }
+
+        union storage {
+            storage() noexcept { }
+            ~storage() { }
+            E elems[N];
+        };
+
+        std::size_t size_;
+        bool on_heap_;
+        storage buf_;
+        std::vector<E> heap_;
+};
+
+template <typename E, std::size_t N>
+bool operator==(accumulating<E,N> const& x, accumulating<E,N> const& y) {
+    return std::equal(std::begin(x), std::end(x), std::begin(y), std::end(y));
+}
+
+template <typename E, std::size_t N>
+bool operator!=(accumulating<E,N> const& x, accumulating<E,N> const& y) {
+    return !(x == y);
+}
+
+/* Combine the values of es into a tuple if all of them hold values.
+ * Otherwise, return every error in argument order. All of es must
+ * share error_type */
+template <std::size_t N = 4, typename... Exps>
+auto validate_all(Exps&&... es) {
+    static_assert(sizeof...(Exps) > 0u, "At least one expected is required");
+    static_assert((expected_detail::is_expected_v<expected_detail::remove_cvref_t<Exps>> && ...),
+                  "Arguments must be instances of expected");
+
+    using error_t =
+        typename std::tuple_element_t<0u, std::tuple<expected_detail::remove_cvref_t<Exps>...>>::error_type;
+    static_assert((std::is_same_v<typename expected_detail::remove_cvref_t<Exps>::error_type, error_t> && ...),
+                  "Arguments must share error_type");
+
+    using result_t = expected<std::tuple<typename expected_detail::remove_cvref_t<Exps>::value_type...>,
+                              accumulating<error_t, N>>;
+
+    if((bool(es) && ...))
+        return result_t(std::in_place, *std::forward<Exps>(es)...);
+
+    accumulating<error_t, N> errors;
+    ((bool(es) ? void() : errors.push_back(std::forward<Exps>(es).error())), ...);
+    return result_t(unexpect, std::move(errors));
+}
+
+/* Run every check on v, collecting all errors. If none of the checks
+ * fail, v is returned. Each check is invoked with v as const lvalue
+ * and must return an expected, all with the same error_type */
+template <std::size_t N = 4, typename V, typename... Checks>
+auto zip_validate(V&& v, Checks&&... checks) {
+    static_assert(sizeof...(Checks) > 0u, "At least one check is required");
+
+    using error_t = typename std::tuple_element_t<0u, std::tuple<
+        expected_detail::remove_cvref_t<std::invoke_result_t<Checks, std::decay_t<V> const&>>...>>::error_type;
+    using result_t = expected<std::decay_t<V>, accumulating<error_t, N>>;
+
+    accumulating<error_t, N> errors;
+    auto run = [&errors, &v](auto&& check) {
+        auto res = std::invoke(std::forward<decltype(check)>(check), std::as_const(v));
+        static_assert(std::is_same_v<typename decltype(res)::error_type, error_t>,
+                      "Checks must share error_type");
+        if(!bool(res))
+            errors.push_back(std::move(res).error());
+    };
+    (run(std::forward<Checks>(checks)), ...);
+
+    if(errors.empty())
+        return result_t(std::in_place, std::forward<V>(v));
+    return result_t(unexpect, std::move(errors));
+}
+
+/* Combine the values of es into a tuple, or return the first error in
+ * argument order. The discriminants are tested in a single combined check
+ * and values are moved out of rvalue arguments */
+template <typename... Exps,
+          expected_detail::enable_if_expected_with_common_error_t<Exps...>* = nullptr>
+auto zip(Exps&&... es) {
+    using error_t = typename std::tuple_element_t<0u, std::tuple<expected_detail::remove_cvref_t<Exps>...>>::error_type;
+    using result_t = expected<std::tuple<typename expected_detail::remove_cvref_t<Exps>::value_type...>, error_t>;
+
+    if((!bool(es) | ...))
+        return expected_detail::first_error<result_t>(std::forward<Exps>(es)...);
+    return result_t(std::in_place, *std::forward<Exps>(es)...);
+}
+
+/* Invoke f with the values of es, or return the first error in argument
+ * order. The discriminants are tested in a single combined check and
+ * values are moved out of rvalue arguments */
+template <typename F, typename... Exps,
+          expected_detail::enable_if_expected_with_common_error_t<Exps...>* = nullptr>
+auto apply(F&& f, Exps&&... es) {
+    using error_t = typename std::tuple_element_t<0u, std::tuple<expected_detail::remove_cvref_t<Exps>...>>::error_type;
+    using invoke_t = std::invoke_result_t<F, decltype(*std::forward<Exps>(es))...>;
+    using result_t = expected<std::decay_t<invoke_t>, error_t>;
+
+    if((!bool(es) | ...))
+        return expected_detail::first_error<result_t>(std::forward<Exps>(es)...);
+
+    if constexpr(std::is_void_v<invoke_t>) {
+        std::invoke(std::forward<F>(f), *std::forward<Exps>(es)...);
+        return result_t();
+    }
+    else {
+        return result_t(std::invoke(std::forward<F>(f), *std::forward<Exps>(es)...));
+    }
+}
+
+/* Reserve storage for n elements in c. A no-op for containers without
+ * reserve. Requests exceeding max_size are reported as alloc_error */
+template <typename Container>
+expected<void, alloc_error> try_reserve(Container& c, std::size_t n) {
+    if constexpr(expected_detail::supports_preallocation_v<Container>) {
+        using value_t = typename Container::value_type;
+        try {
+            c.reserve(n);
+        }
+        catch(std::bad_alloc const&) {
+            return unexpected(alloc_error{n * sizeof(value_t)});
+        }
+        catch(std::length_error const&) {
+            return unexpected(alloc_error{n * sizeof(value_t)});
+        }
+    }
+    else {
+        (void)c;
+        (void)n;
+    }
+    return {};
+}
+#endif
+
+#if defined VIEN_EXPECTED_EXTENDED && defined VIEN_EXPECTED_COROUTINES
+/* Number of bytes per thread set aside for the frames of coroutines
+ * returning expected<T,E>. Specialize with a non-zero size to allocate
+ * the frames from a per-thread arena, falling back to operator new once
+ * it is exhausted. The default of zero uses operator new throughout */
+template <typename T, typename E>
+struct coroutine_arena_size : std::integral_constant<std::size_t, 0u> { };
+
+namespace expected_detail {
+
+/* Per-thread stack of coroutine frames. A coroutine returning expected
+ * never suspends past its own body, so frames are released in reverse
+ * order of allocation */
+template <std::size_t Size>
+class coroutine_arena {
+    public:
+        static void* allocate(std::size_t n) {
+            auto& arena = instance();
+            n = align_up(n);
+            if(n <= size - arena.top_) {
+                void* p = arena.buf_ + arena.top_;
+                arena.top_ += n;
+                return p;
+            }
+            return ::operator new(n);
+        }
+
+        static void deallocate(void* p, std::size_t n) noexcept {
+            auto& arena = instance();
+            auto* bytes = static_cast<unsigned char*>(p);
+            if(bytes >= arena.buf_ && bytes < arena.buf_ + size) {
+                assert(bytes + align_up(n) == arena.buf_ + arena.top_ &&
+                       "Coroutine frames must be released in reverse order of allocation");
+                arena.top_ = static_cast<std::size_t>(bytes - arena.buf_);
+                return;
+            }
+            ::operator delete(p);
+        }
+
+    private:
+        static constexpr std::size_t size = Size;
+        static constexpr std::size_t align = __STDCPP_DEFAULT_NEW_ALIGNMENT__;
+
+        alignas(align) unsigned char buf_[size]{};
+        std::size_t top_{0u};
+
+        static constexpr std::size_t align_up(std::size_t n) noexcept {
+            return (n + align - 1u) & ~(align - 1u);
+        }
+
+        static coroutine_arena& instance() noexcept {
+            static thread_local coroutine_arena arena;
+            return arena;
+        }
+};
+
+/* Object returned from the ramp of the coroutine. The result is written
+ * here by the promise and converted to expected once the coroutine has
+ * finished, which requires the conversion of the return object to be
+ * deferred until the coroutine first returns to its caller */
+template <typename T, typename E>
+class coroutine_return_object {
+    public:
+        explicit coroutine_return_object(coroutine_return_object*& slot) noexcept : result_{} {
+            slot = this;
+        }
+        coroutine_return_object(coroutine_return_object const&) = delete;
+        coroutine_return_object& operator=(coroutine_return_object const&) = delete;
+
+        template <typename... Args>
+        void emplace(Args&&... args) {
+            result_.emplace(std::forward<Args>(args)...);
+        }
+
+        operator expected<T,E>() {
+            return std::move(*result_);
+        }
+
+    private:
+        std::optional<expected<T,E>> result_;
+};
+
+/* Awaiter produced by co_await on an expected. On error, the error is
+ * stored as the result and the coroutine is destroyed, unwinding its
+ * locals just as a return would */
+template <typename Exp, typename Promise>
+class coroutine_awaiter {
+    using value_t = typename remove_cvref_t<Exp>::value_type;
+
+    public:
+        explicit coroutine_awaiter(Exp&& e) noexcept : e_{std::addressof(e)} { }
+
+        bool await_ready() const noexcept {
+            return e_->has_value();
+        }
+
+        void await_suspend(std::coroutine_handle<Promise> handle) {
+            handle.promise().set_error(std::forward<Exp>(*e_).error());
+            handle.destroy();
+        }
+
+        /* Lvalues are unwrapped by reference, values are moved out of rvalues */
+        decltype(auto) await_resume() {
+            if constexpr(std::is_void_v<value_t>)
+                return;
+            else if constexpr(std::is_lvalue_reference_v<Exp>)
+                return **e_;
+            else
+                return value_t(*std::move(*e_));
+        }
+
+    private:
+        std::remove_reference_t<Exp>* e_;
+};
+
+template <typename T, typename E>
+class coroutine_promise;
+
+template <typename T, typename E>
+class coroutine_promise_base {
+    public:
+        using return_object_t = coroutine_return_object<T,E>;
+
+        coroutine_promise_base() noexcept = default;
+        coroutine_promise_base(coroutine_promise_base const&) = delete;
+        coroutine_promise_base& operator=(coroutine_promise_base const&) = delete;
+
+        return_object_t get_return_object() noexcept {
+            return return_object_t(result_);
+        }
+
+        std::suspend_never initial_suspend() const noexcept {
+            return {};
+        }
+
+        std::suspend_never final_suspend() const noexcept {
+            return {};
+        }
+
+        /* Rethrown rather than stored, as throwing from the conversion of the
+         * return object would release the already destroyed frame again */
+        void unhandled_exception() {
+            throw;
+        }
+
+        template <typename G>
+        void set_error(G&& g) {
+            result_->emplace(unexpect, std::forward<G>(g));
+        }
+
+        template <typename Exp,
+                  std::enable_if_t<is_expected_v<remove_cvref_t<Exp>>>* = nullptr>
+        auto await_transform(Exp&& e) noexcept {
+            static_assert(std::is_constructible_v<E, decltype(std::forward<Exp>(e).error())>,
+                          "Error type of the awaited expected must be convertible to E");
+            return coroutine_awaiter<Exp&&, coroutine_promise<T,E>>(std::forward<Exp>(e));
+        }
+
+        static void* operator new(std::size_t n) {
+            if constexpr(arena_size != 0u)
+                return coroutine_arena<arena_size>::allocate(n);
+            else
+                return ::operator new(n);
+        }
+
+        static void operator delete(void* p, std::size_t n) noexcept {
+            if constexpr(arena_size != 0u)
+                coroutine_arena<arena_size>::deallocate(p, n);
+            else
+                ::operator delete(p);
+        }
+
+    protected:
+        return_object_t* result_{};
+
+    private:
+        static constexpr std::size_t arena_size = coroutine_arena_size<T,E>::value;
+};
+
+template <typename T, typename E>
+class coroutine_promise : public coroutine_promise_base<T,E> {
+    public:
+        template <typename U = T>
+        void return_value(U&& u) {
+            this->result_->emplace(std::forward<U>(u));
+        }
+};
+
+template <typename E>
+class coroutine_promise<void, E> : public coroutine_promise_base<void,E> {
+    public:
+        void return_void() {
+            this->result_->emplace();
+        }
+};
+
+} /* namespace expected_detail */
+#endif
+
 } /* namespace v1 */
 } /* namespace vien */
 
@@ -3973,6 +6418,63 @@ template <typename E1,
 void swap(vien::unexpected<E1>& x, vien::unexpected<E1>& y) noexcept(noexcept(x.swap(y))) {
     x.swap(y);
 }
+
+#ifdef VIEN_EXPECTED_EXTENDED
+/* Allows allocator-aware containers to pass their allocator to
+ * the contained value or error */
+template <typename T, typename E, typename A>
+struct uses_allocator<vien::expected<T,E>, A>
+    : bool_constant<uses_allocator_v<T,A> || uses_allocator_v<E,A>> { };
+
+#ifdef VIEN_EXPECTED_COROUTINES
+template <typename T, typename E, typename... Args>
+struct coroutine_traits<vien::expected<T,E>, Args...> {
+    using promise_type = vien::expected_detail::coroutine_promise<T,E>;
+};
+#endif
+#endif
 } /* namespace std */
 
+#ifdef VIEN_EXPECTED_EXTENDED
+#define VIEN_TRY_CONCAT_IMPL(a, b) a##b
+#define VIEN_TRY_CONCAT(a, b) VIEN_TRY_CONCAT_IMPL(a, b)
+
+/* Evaluate to the value of the expected produced by expr, or return its
+ * error from the enclosing function. The value and error are moved if expr
+ * is an rvalue. The error is returned as unexpected<E>, so the enclosing
+ * function's return type may use any error type constructible from E */
+#if defined(__GNUC__) || defined(__clang__)
+#define VIEN_TRY_IMPL(tmp, ...) __extension__ ({                                        \
+        auto&& tmp = (__VA_ARGS__);                                                     \
+        if(!tmp.has_value())                                                            \
+            return ::vien::unexpected(std::forward<decltype(tmp)>(tmp).error());       \
+        ::vien::expected_detail::try_unwrap(std::forward<decltype(tmp)>(tmp));          \
+    })
+
+/* __COUNTER__ keeps nested uses from shadowing each other */
+#define VIEN_TRY(...) \
+    VIEN_TRY_IMPL(VIEN_TRY_CONCAT(vien_try_tmp_, __COUNTER__), __VA_ARGS__)
+#endif
+
+/* Portable counterparts of VIEN_TRY. VIEN_TRY_ASSIGN assigns the value
+ * to lhs, which may be a declaration, and VIEN_TRY_VOID only propagates
+ * the error */
+#define VIEN_TRY_ASSIGN_IMPL(tmp, lhs, ...)                                             \
+    auto&& tmp = (__VA_ARGS__);                                                         \
+    if(!tmp.has_value())                                                                \
+        return ::vien::unexpected(std::forward<decltype(tmp)>(tmp).error());           \
+    lhs = ::vien::expected_detail::try_unwrap(std::forward<decltype(tmp)>(tmp))
+
+#define VIEN_TRY_ASSIGN(lhs, ...) \
+    VIEN_TRY_ASSIGN_IMPL(VIEN_TRY_CONCAT(vien_try_tmp_, __LINE__), lhs, __VA_ARGS__)
+
+#define VIEN_TRY_VOID(...)                                                              \
+    do {                                                                                \
+        auto&& vien_try_tmp_ = (__VA_ARGS__);                                           \
+        if(!vien_try_tmp_.has_value())                                                  \
+            return ::vien::unexpected(                                                  \
+                std::forward<decltype(vien_try_tmp_)>(vien_try_tmp_).error());          \
+    } while(0)
+#endif
+
 #endif
@@ -0,0 +1,2918 @@
+/* Concurrency utilities built on vien::expected. Requires the
+ * extensions enabled by VIEN_EXPECTED_EXTENDED, which is defined
+ * by this header unless expected.h has already been included
+ * without it. */
+
+#ifndef VIEN_EXPECTED_CONCURRENT_H
+#define VIEN_EXPECTED_CONCURRENT_H
+
+/*
+    --expected_concurrent synopsis--
+
+namespace vien {
+inline namespace v1 {
+
+__ class unique_task __
+
+class unique_task {
+    public:
+        unique_task() noexcept;
+        template <typename F>
+        unique_task(F&&);
+        unique_task(unique_task&&) noexcept;
+        unique_task& operator=(unique_task&&) noexcept;
+        ~unique_task();
+
+        explicit operator bool() const noexcept;
+        void operator()();
+};
+
+__ class inline_executor __
+
+struct inline_executor {
+    template <typename F>
+    void execute(F&&) const;
+};
+
+__ class template expected_promise __
+
+template <typename T, typename E>
+class expected_promise {
+    public:
+        expected_promise();
+        expected_promise(expected_promise&&) noexcept;
+        expected_promise& operator=(expected_promise&&) noexcept;
+        ~expected_promise();
+
+        expected_future<T,E> get_future();
+
+        template <typename... Args>
+        void set_value(Args&&...);
+        template <typename G>
+        void set_error(G&&);
+        void set_result(expected<T,E>);
+        void set_exception(std::exception_ptr);
+};
+
+__ class template expected_future __
+
+template <typename T, typename E>
+class expected_future {
+    public:
+        using value_type = T;
+        using error_type = E;
+
+        expected_future() noexcept;
+        expected_future(expected_future&&) noexcept;
+        expected_future& operator=(expected_future&&) noexcept;
+        ~expected_future();
+
+        bool valid() const noexcept;
+        bool is_ready() const;
+        void wait() const;
+        template <typename Rep, typename Period>
+        bool wait_for(std::chrono::duration<Rep, Period> const&) const;
+        expected<T,E> get();
+
+        template <typename F>
+        expected_future<see below, E> map(F&&) &&;
+        template <typename Executor, typename F>
+        expected_future<see below, E> map(Executor, F&&) &&;
+
+        template <typename F>
+        expected_future<T,E> and_then(F&&) &&;
+        template <typename Executor, typename F>
+        expected_future<T,E> and_then(Executor, F&&) &&;
+
+        template <typename F>
+        expected_future<T, see below> map_error(F&&) &&;
+        template <typename Executor, typename F>
+        expected_future<T, see below> map_error(Executor, F&&) &&;
+};
+
+__ class thread_pool __
+
+class thread_pool {
+    public:
+        class executor_type {
+            public:
+                explicit executor_type(thread_pool&) noexcept;
+                void execute(unique_task) const;
+                std::size_t concurrency() const noexcept;
+        };
+
+        explicit thread_pool(std::size_t = std::thread::hardware_concurrency());
+        ~thread_pool();
+
+        void execute(unique_task);
+        executor_type get_executor() noexcept;
+        std::size_t concurrency() const noexcept;
+};
+
+__ parallel invocation __
+
+struct cancel_on_error_t {
+    explicit cancel_on_error_t() = default;
+};
+
+inline constexpr cancel_on_error_t cancel_on_error{};
+
+template <typename Executor, typename Tasks>
+std::vector<expected<see below, see below>> parallel_invoke_all(Executor&&, Tasks&);
+template <typename Executor, typename Tasks>
+std::vector<expected<see below, see below>> parallel_invoke_all(Executor&&, Tasks&, cancel_on_error_t);
+
+template <typename Executor, typename Range, typename T, typename Reduce, typename Transform>
+expected<T, see below> try_transform_reduce(Executor&&, Range&&, T, Reduce, Transform);
+
+__ class template atomic_expected __
+
+template <typename T, typename E>
+class atomic_expected {
+    public:
+        using value_type = T;
+        using error_type = E;
+
+        atomic_expected() noexcept;
+        ~atomic_expected();
+
+        template <typename... Args>
+        bool set_value(Args&&...);
+        template <typename G>
+        bool set_error(G&&);
+        bool set_result(expected<T,E>);
+
+        bool is_ready() const noexcept;
+        void wait() const;
+        expected<T,E> const& get() const;
+        expected<T,E> const* try_get() const noexcept;
+};
+
+__ class template packed_expected __
+
+template <typename T, typename E>
+class packed_expected {
+    public:
+        using value_type = T;
+        using error_type = E;
+        using unexpected_type = unexpected<E>;
+
+        packed_expected() noexcept;
+        template <typename U = T>
+        packed_expected(U&&);
+        template <typename... Args>
+        explicit packed_expected(std::in_place_t, Args&&...);
+        template <typename... Args>
+        explicit packed_expected(unexpect_t, Args&&...);
+        template <typename G>
+        packed_expected(unexpected<G> const&);
+        packed_expected(expected<T,E> const&);
+
+        expected<T,E> to_expected() const;
+
+        bool has_value() const noexcept;
+        explicit operator bool() const noexcept;
+        T operator*() const noexcept;
+        T value() const;
+        E error() const noexcept;
+        template <typename U>
+        T value_or(U&&) const;
+
+        template <typename F>
+        packed_expected<see below, E> map(F&&) const;
+        template <typename F>
+        packed_expected<T, see below> map_error(F&&) const;
+        template <typename F>
+        packed_expected and_then(F&&) const;
+        template <typename F>
+        packed_expected or_else(F&&) const;
+
+        friend bool operator==(packed_expected const&, packed_expected const&) noexcept;
+        friend bool operator!=(packed_expected const&, packed_expected const&) noexcept;
+};
+
+__ class template latest_expected __
+
+template <typename T, typename E>
+class latest_expected {
+    public:
+        using value_type = T;
+        using error_type = E;
+
+        latest_expected();
+        explicit latest_expected(expected<T,E> const&);
+
+        expected<T,E> read() const;
+        template <typename F>
+        decltype(auto) visit(F&&) const;
+        bool has_value() const;
+
+        void publish(expected<T,E>);
+};
+
+__ class template lazy_expected __
+
+template <typename T, typename E, typename F = std::function<expected<T,E>()>>
+class lazy_expected {
+    public:
+        using value_type = T;
+        using error_type = E;
+        using reference_type = see below;
+
+        explicit lazy_expected(F, std::function<bool(E const&)> = {});
+        ~lazy_expected();
+
+        expected<reference_type, E> get();
+        bool is_ready() const noexcept;
+};
+
+template <typename F>
+lazy_expected(F) -> lazy_expected<see below>;
+template <typename F, typename R>
+lazy_expected(F, R) -> lazy_expected<see below>;
+
+__ class template shared_expected __
+
+template <typename T, typename E>
+class shared_expected {
+    public:
+        using value_type = T;
+        using error_type = E;
+
+        shared_expected(expected<T,E>);
+        template <typename... Args>
+        explicit shared_expected(std::in_place_t, Args&&...);
+        template <typename... Args>
+        explicit shared_expected(unexpect_t, Args&&...);
+
+        shared_expected(shared_expected const&) noexcept;
+        shared_expected(shared_expected&&) noexcept;
+        ~shared_expected();
+
+        shared_expected& operator=(shared_expected const&) noexcept;
+        shared_expected& operator=(shared_expected&&) noexcept;
+
+        expected<T,E> const& get() const noexcept;
+        std::size_t use_count() const noexcept;
+
+        T const* operator->() const;
+        T const& operator*() const;
+        explicit operator bool() const noexcept;
+        bool has_value() const noexcept;
+        T const& value() const;
+        E const& error() const;
+        template <typename U>
+        T value_or(U&&) const;
+
+        template <typename F>
+        expected<see below, E> map(F&&) const;
+        template <typename F>
+        expected<T, see below> map_error(F&&) const;
+        template <typename F>
+        expected<T,E> and_then(F&&) const;
+        template <typename F>
+        expected<T,E> or_else(F&&) const;
+};
+
+__ class template expected_channel __
+
+template <typename T, typename E>
+class expected_channel {
+    public:
+        using value_type = T;
+        using error_type = E;
+
+        explicit expected_channel(std::size_t);
+        ~expected_channel();
+
+        std::size_t capacity() const noexcept;
+        bool is_closed() const noexcept;
+
+        bool try_push(expected<T,E>&&);
+        bool try_push(expected<T,E> const&);
+
+        std::optional<expected<T,E>> try_pop();
+        template <typename OutputIt>
+        expected<std::size_t, E> try_pop_batch(OutputIt, std::size_t);
+        expected<T,E> pop();
+
+        bool close(E);
+};
+
+__ senders __
+
+// Senders expose value_type and error_type, void meaning no value or no
+// error channel, and connect(Receiver) &&, returning an operation state
+// with start(). Receivers provide set_value, set_error and set_stopped
+
+class run_loop {
+    public:
+        class scheduler {
+            public:
+                see below schedule() const noexcept;
+        };
+
+        scheduler get_scheduler() noexcept;
+        void run();
+        void finish();
+};
+
+template <typename T, typename E>
+see below as_sender(expected<T,E>);
+
+template <typename Sender, typename F>
+see below then_expected(Sender&&, F&&);
+
+template <typename Sender, typename F>
+see below let_expected(Sender&&, F&&);
+
+template <typename Sender>
+see below into_expected(Sender&&);
+
+template <typename Sender>
+std::optional<expected<see below, see below>> sync_wait_expected(Sender&&);
+
+}
+}
+ */
+
+#if defined VIEN_EXPECTED_H && !defined VIEN_EXPECTED_EXTENDED
+#error "expected_concurrent.h requires expected.h to be included with VIEN_EXPECTED_EXTENDED defined"
+#endif
+
+#ifndef VIEN_EXPECTED_EXTENDED
+#define VIEN_EXPECTED_EXTENDED
+#endif
+
+#include "expected.h"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <optional>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <variant>
+#include <vector>
+
+#if defined __cpp_lib_atomic_wait && __cpp_lib_atomic_wait >= 201907L
+#define VIEN_EXPECTED_ATOMIC_WAIT
+#endif
+
+/* Number of released shared states and continuations of each type
+ * kept per thread for reuse */
+#ifndef VIEN_EXPECTED_FUTURE_POOL_SIZE
+#define VIEN_EXPECTED_FUTURE_POOL_SIZE 64
+#endif
+
+namespace vien {
+inline namespace v1 {
+
+template <typename, typename>
+class expected_promise;
+
+template <typename, typename>
+class expected_future;
+
+namespace concurrent_detail {
+
+/* Assumed size of a cache line, used for padding data written by
+ * different threads */
+inline constexpr std::size_t cache_line_size = 64u;
+
+/* Per-thread free list of storage for objects of type T. Storage
+ * released on another thread than it was allocated on migrates to
+ * the free list of that thread */
+template <typename T>
+class object_pool {
+    public:
+        template <typename... Args>
+        static T* create(Args&&... args) {
+            void* p = allocate();
+            try {
+                return ::new(p) T(std::forward<Args>(args)...);
+            }
+            catch(...) {
+                deallocate(p);
+                throw;
+            }
+        }
+
+        static void destroy(T* p) noexcept {
+            p->~T();
+            deallocate(p);
+        }
+
+    private:
+        union node {
+            node* next;
+            alignas(T) unsigned char storage[sizeof(T)];
+        };
+
+        struct free_list {
+            node* head{nullptr};
+            std::size_t size{0u};
+
+            free_list() noexcept = default;
+            free_list(free_list const&) = delete;
+            free_list& operator=(free_list const&) = delete;
+
+            ~free_list() {
+                while(head) {
+                    node* next = head->next;
+                    ::operator delete(head, std::align_val_t{alignof(node)});
+                    head = next;
+                }
+            }
+        };
+
+        static free_list& local() noexcept {
+            static thread_local free_list list;
+            return list;
+        }
+
+        static void* allocate() {
+            auto& list = local();
+            if(list.head) {
+                node* n = list.head;
+                list.head = n->next;
+                --list.size;
+                return n;
+            }
+            return ::operator new(sizeof(node), std::align_val_t{alignof(node)});
+        }
+
+        static void deallocate(void* p) noexcept {
+            auto& list = local();
+            if(list.size < VIEN_EXPECTED_FUTURE_POOL_SIZE) {
+                node* n = ::new(p) node;
+                n->next = list.head;
+                list.head = n;
+                ++list.size;
+                return;
+            }
+            ::operator delete(p, std::align_val_t{alignof(node)});
+        }
+};
+
+/* Invoked with the outcome of a shared state once it is settled */
+template <typename T, typename E>
+class continuation {
+    public:
+        continuation() noexcept = default;
+        continuation(continuation const&) = delete;
+        continuation& operator=(continuation const&) = delete;
+
+        virtual void on_result(expected<T,E>&&) = 0;
+        virtual void on_exception(std::exception_ptr) = 0;
+        /* Return the continuation to its pool */
+        virtual void destroy() noexcept = 0;
+
+    protected:
+        ~continuation() = default;
+};
+
+/* State shared between an expected_promise and its expected_future.
+ * Owned jointly by the two through an intrusive reference count. Once
+ * a continuation is attached, the outcome is handed to it directly
+ * rather than stored */
+template <typename T, typename E>
+class shared_state {
+    public:
+        using result_t = expected<T,E>;
+
+        shared_state() noexcept
+            : mtx_{}, cv_{}, result_{}, exception_{}, continuation_{nullptr},
+              refs_{1u}, ready_{false}, broken_{false} { }
+        shared_state(shared_state const&) = delete;
+        shared_state& operator=(shared_state const&) = delete;
+
+        ~shared_state() {
+            if(continuation_)
+                continuation_->destroy();
+        }
+
+        static shared_state* create() {
+            return object_pool<shared_state>::create();
+        }
+
+        void add_ref() noexcept {
+            refs_.fetch_add(1u, std::memory_order_relaxed);
+        }
+
+        void release() noexcept {
+            if(refs_.fetch_sub(1u, std::memory_order_acq_rel) == 1u)
+                object_pool<shared_state>::destroy(this);
+        }
+
+        bool ready() const {
+            std::lock_guard<std::mutex> lock{mtx_};
+            return ready_;
+        }
+
+        void set_result(result_t&& r) {
+            std::unique_lock<std::mutex> lock{mtx_};
+            continuation<T,E>* c = settle(lock);
+            if(c) {
+                lock.unlock();
+                c->on_result(std::move(r));
+                c->destroy();
+                return;
+            }
+            result_.emplace(std::move(r));
+            lock.unlock();
+            cv_.notify_all();
+        }
+
+        void set_exception(std::exception_ptr e) {
+            std::unique_lock<std::mutex> lock{mtx_};
+            continuation<T,E>* c = settle(lock);
+            if(c) {
+                lock.unlock();
+                c->on_exception(std::move(e));
+                c->destroy();
+                return;
+            }
+            exception_ = std::move(e);
+            lock.unlock();
+            cv_.notify_all();
+        }
+
+        /* Called by a promise destroyed without being satisfied. An
+         * attached continuation is destroyed without being run, breaking
+         * the promise it holds in turn */
+        void abandon() noexcept {
+            std::unique_lock<std::mutex> lock{mtx_};
+            if(ready_)
+                return;
+            ready_ = true;
+            broken_ = true;
+            continuation<T,E>* c = std::exchange(continuation_, nullptr);
+            lock.unlock();
+            cv_.notify_all();
+            if(c)
+                c->destroy();
+        }
+
+        void wait() const {
+            std::unique_lock<std::mutex> lock{mtx_};
+            cv_.wait(lock, [this] { return ready_; });
+        }
+
+        template <typename Rep, typename Period>
+        bool wait_for(std::chrono::duration<Rep, Period> const& rel) const {
+            std::unique_lock<std::mutex> lock{mtx_};
+            return cv_.wait_for(lock, rel, [this] { return ready_; });
+        }
+
+        result_t take() {
+            wait();
+            if(broken_)
+                throw std::future_error(std::future_errc::broken_promise);
+            if(exception_)
+                std::rethrow_exception(exception_);
+            return std::move(*result_);
+        }
+
+        /* Run c with the outcome, immediately if already settled */
+        void then(continuation<T,E>* c) {
+            std::unique_lock<std::mutex> lock{mtx_};
+            if(!ready_) {
+                continuation_ = c;
+                return;
+            }
+            lock.unlock();
+
+            if(broken_)
+                c->destroy();
+            else if(exception_) {
+                c->on_exception(exception_);
+                c->destroy();
+            }
+            else {
+                c->on_result(std::move(*result_));
+                c->destroy();
+            }
+        }
+
+    private:
+        mutable std::mutex mtx_;
+        mutable std::condition_variable cv_;
+        std::optional<result_t> result_;
+        std::exception_ptr exception_;
+        continuation<T,E>* continuation_;
+        std::atomic<unsigned> refs_;
+        bool ready_;
+        bool broken_;
+
+        continuation<T,E>* settle(std::unique_lock<std::mutex> const&) {
+            if(ready_)
+                throw std::future_error(std::future_errc::promise_already_satisfied);
+            ready_ = true;
+            return std::exchange(continuation_, nullptr);
+        }
+};
+
+/* The operations available as continuations. schedule is true if the
+ * callable is to be invoked for r, otherwise apply only forwards r */
+struct map_op {
+    template <typename Exp>
+    static bool schedule(Exp const& r) noexcept {
+        return bool(r);
+    }
+
+    template <typename Exp, typename F>
+    static auto apply(Exp&& r, F&& f) {
+        return std::forward<Exp>(r).map(std::forward<F>(f));
+    }
+};
+
+struct and_then_op {
+    template <typename Exp>
+    static bool schedule(Exp const& r) noexcept {
+        return bool(r);
+    }
+
+    template <typename Exp, typename F>
+    static auto apply(Exp&& r, F&& f) {
+        return std::forward<Exp>(r).and_then(std::forward<F>(f));
+    }
+};
+
+struct map_error_op {
+    template <typename Exp>
+    static bool schedule(Exp const& r) noexcept {
+        return !bool(r);
+    }
+
+    template <typename Exp, typename F>
+    static auto apply(Exp&& r, F&& f) {
+        return std::forward<Exp>(r).map_error(std::forward<F>(f));
+    }
+};
+
+template <typename T, typename E, typename F, typename Op>
+using continuation_result_t =
+    decltype(Op::apply(std::declval<expected<T,E>>(), std::declval<F>()));
+
+template <typename T, typename E, typename F, typename Op>
+using continuation_future_t =
+    expected_future<typename continuation_result_t<T,E,F,Op>::value_type,
+                    typename continuation_result_t<T,E,F,Op>::error_type>;
+
+template <typename T, typename E, typename F, typename Op>
+using continuation_promise_t =
+    expected_promise<typename continuation_result_t<T,E,F,Op>::value_type,
+                     typename continuation_result_t<T,E,F,Op>::error_type>;
+
+/* Continuation applying Op with f to the outcome and satisfying the
+ * downstream promise. If Op does not need to invoke f, the result is
+ * forwarded on the settling thread without involving the executor */
+template <typename T, typename E, typename Executor, typename F, typename Op>
+class continuation_impl final : public continuation<T,E> {
+    using promise_t = continuation_promise_t<T,E,F,Op>;
+
+    public:
+        continuation_impl(Executor ex, F f, promise_t p)
+            : continuation<T,E>{}, ex_{std::move(ex)}, f_{std::move(f)}, p_{std::move(p)} { }
+
+        void on_result(expected<T,E>&& r) override {
+            if(!Op::schedule(r)) {
+                p_.set_result(Op::apply(std::move(r), std::move(f_)));
+                return;
+            }
+
+            ex_.execute([f = std::move(f_), p = std::move(p_), r = std::move(r)]() mutable {
+                try {
+                    p.set_result(Op::apply(std::move(r), std::move(f)));
+                }
+                catch(...) {
+                    p.set_exception(std::current_exception());
+                }
+            });
+        }
+
+        void on_exception(std::exception_ptr e) override {
+            p_.set_exception(std::move(e));
+        }
+
+        void destroy() noexcept override {
+            object_pool<continuation_impl>::destroy(this);
+        }
+
+    private:
+        Executor ex_;
+        F f_;
+        promise_t p_;
+};
+
+} /* namespace concurrent_detail */
+
+/* Move-only type-erased nullary callable */
+class unique_task {
+    public:
+        unique_task() noexcept : callable_{nullptr} { }
+
+        template <typename F,
+                  std::enable_if_t<!std::is_same_v<std::decay_t<F>, unique_task>>* = nullptr>
+        unique_task(F&& f) : callable_{new model<std::decay_t<F>>(std::forward<F>(f))} { }
+
+        unique_task(unique_task&& other) noexcept
+            : callable_{std::exchange(other.callable_, nullptr)} { }
+
+        unique_task& operator=(unique_task&& other) noexcept {
+            if(this != &other) {
+                delete callable_;
+                callable_ = std::exchange(other.callable_, nullptr);
+            }
+            return *this;
+        }
+
+        unique_task(unique_task const&) = delete;
+        unique_task& operator=(unique_task const&) = delete;
+
+        ~unique_task() {
+            delete callable_;
+        }
+
+        explicit operator bool() const noexcept {
+            return callable_ != nullptr;
+        }
+
+        void operator()() {
+            callable_->invoke();
+        }
+
+    private:
+        struct concept_t {
+            virtual ~concept_t() = default;
+            virtual void invoke() = 0;
+        };
+
+        template <typename F>
+        struct model final : concept_t {
+            explicit model(F&& f) : f_{std::move(f)} { }
+            explicit model(F const& f) : f_{f} { }
+
+            void invoke() override {
+                std::invoke(f_);
+            }
+
+            F f_;
+        };
+
+        concept_t* callable_;
+};
+
+/* Executor running tasks on the calling thread */
+struct inline_executor {
+    template <typename F>
+    void execute(F&& f) const {
+        std::invoke(std::forward<F>(f));
+    }
+};
+
+template <typename T, typename E>
+class expected_promise {
+    using state_t = concurrent_detail::shared_state<T,E>;
+
+    public:
+        expected_promise() : state_{state_t::create()}, retrieved_{false} { }
+
+        expected_promise(expected_promise&& other) noexcept
+            : state_{std::exchange(other.state_, nullptr)}, retrieved_{other.retrieved_} { }
+
+        expected_promise& operator=(expected_promise&& other) noexcept {
+            if(this != &other) {
+                reset();
+                state_ = std::exchange(other.state_, nullptr);
+                retrieved_ = other.retrieved_;
+            }
+            return *this;
+        }
+
+        expected_promise(expected_promise const&) = delete;
+        expected_promise& operator=(expected_promise const&) = delete;
+
+        ~expected_promise() {
+            reset();
+        }
+
+        expected_future<T,E> get_future() {
+            if(!state_)
+                throw std::future_error(std::future_errc::no_state);
+            if(retrieved_)
+                throw std::future_error(std::future_errc::future_already_retrieved);
+            retrieved_ = true;
+            state_->add_ref();
+            return expected_future<T,E>(state_);
+        }
+
+        template <typename... Args>
+        void set_value(Args&&... args) {
+            if constexpr(std::is_void_v<T>) {
+                static_assert(sizeof...(Args) == 0u, "set_value takes no arguments for void T");
+                set_result(expected<T,E>());
+            }
+            else {
+                set_result(expected<T,E>(std::in_place, std::forward<Args>(args)...));
+            }
+        }
+
+        template <typename G>
+        void set_error(G&& g) {
+            set_result(expected<T,E>(unexpect, std::forward<G>(g)));
+        }
+
+        void set_result(expected<T,E> r) {
+            if(!state_)
+                throw std::future_error(std::future_errc::no_state);
+            state_->set_result(std::move(r));
+        }
+
+        void set_exception(std::exception_ptr e) {
+            if(!state_)
+                throw std::future_error(std::future_errc::no_state);
+            state_->set_exception(std::move(e));
+        }
+
+    private:
+        state_t* state_;
+        bool retrieved_;
+
+        void reset() noexcept {
+            if(state_) {
+                state_->abandon();
+                std::exchange(state_, nullptr)->release();
+            }
+        }
+};
+
+/* Future for an expected, settled through an expected_promise.
+ * Continuations attached through map, and_then and map_error mirror
+ * the corresponding member functions of expected. They run on the
+ * supplied executor, or inline on the settling thread if none is
+ * given. Continuations with nothing to do, such as map on an error,
+ * forward the result without being scheduled */
+template <typename T, typename E>
+class expected_future {
+    using state_t = concurrent_detail::shared_state<T,E>;
+
+    template <typename, typename>
+    friend class expected_promise;
+
+    public:
+        using value_type = T;
+        using error_type = E;
+
+        expected_future() noexcept : state_{nullptr} { }
+
+        expected_future(expected_future&& other) noexcept
+            : state_{std::exchange(other.state_, nullptr)} { }
+
+        expected_future& operator=(expected_future&& other) noexcept {
+            if(this != &other) {
+                reset();
+                state_ = std::exchange(other.state_, nullptr);
+            }
+            return *this;
+        }
+
+        expected_future(expected_future const&) = delete;
+        expected_future& operator=(expected_future const&) = delete;
+
+        ~expected_future() {
+            reset();
+        }
+
+        bool valid() const noexcept {
+            return state_ != nullptr;
+        }
+
+        bool is_ready() const {
+            return checked_state().ready();
+        }
+
+        void wait() const {
+            checked_state().wait();
+        }
+
+        template <typename Rep, typename Period>
+        bool wait_for(std::chrono::duration<Rep, Period> const& rel) const {
+            return checked_state().wait_for(rel);
+        }
+
+        /* Block until settled and consume the result. Rethrows an exception
+         * stored through the promise */
+        expected<T,E> get() {
+            checked_state();
+            state_t* state = std::exchange(state_, nullptr);
+            try {
+                auto r = state->take();
+                state->release();
+                return r;
+            }
+            catch(...) {
+                state->release();
+                throw;
+            }
+        }
+
+        template <typename F>
+        auto map(F&& f) && {
+            return std::move(*this).map(inline_executor{}, std::forward<F>(f));
+        }
+
+        template <typename Executor, typename F>
+        auto map(Executor ex, F&& f) && {
+            return then<concurrent_detail::map_op>(std::move(ex), std::forward<F>(f));
+        }
+
+        template <typename F>
+        auto and_then(F&& f) && {
+            return std::move(*this).and_then(inline_executor{}, std::forward<F>(f));
+        }
+
+        template <typename Executor, typename F>
+        auto and_then(Executor ex, F&& f) && {
+            return then<concurrent_detail::and_then_op>(std::move(ex), std::forward<F>(f));
+        }
+
+        template <typename F>
+        auto map_error(F&& f) && {
+            return std::move(*this).map_error(inline_executor{}, std::forward<F>(f));
+        }
+
+        template <typename Executor, typename F>
+        auto map_error(Executor ex, F&& f) && {
+            return then<concurrent_detail::map_error_op>(std::move(ex), std::forward<F>(f));
+        }
+
+    private:
+        state_t* state_;
+
+        explicit expected_future(state_t* state) noexcept : state_{state} { }
+
+        state_t& checked_state() const {
+            if(!state_)
+                throw std::future_error(std::future_errc::no_state);
+            return *state_;
+        }
+
+        void reset() noexcept {
+            if(state_)
+                std::exchange(state_, nullptr)->release();
+        }
+
+        template <typename Op, typename Executor, typename F>
+        concurrent_detail::continuation_future_t<T, E, std::decay_t<F>, Op> then(Executor ex, F&& f) {
+            using continuation_t =
+                concurrent_detail::continuation_impl<T, E, Executor, std::decay_t<F>, Op>;
+            using promise_t = concurrent_detail::continuation_promise_t<T, E, std::decay_t<F>, Op>;
+
+            state_t& state = checked_state();
+            promise_t p;
+            auto next = p.get_future();
+            auto* c = concurrent_detail::object_pool<continuation_t>::create(
+                std::move(ex), std::forward<F>(f), std::move(p));
+
+            state.then(c);
+            reset();
+            return next;
+        }
+};
+
+/* Fixed-size pool of worker threads. Each worker owns a deque of tasks,
+ * popping from the back of its own and stealing from the front of the
+ * others when it runs dry. Tasks submitted from a worker are pushed to
+ * its own deque, others are distributed round-robin. Remaining tasks
+ * are run before the destructor returns */
+class thread_pool {
+    public:
+        class executor_type {
+            public:
+                explicit executor_type(thread_pool& pool) noexcept : pool_{&pool} { }
+
+                void execute(unique_task task) const {
+                    pool_->execute(std::move(task));
+                }
+
+                std::size_t concurrency() const noexcept {
+                    return pool_->concurrency();
+                }
+
+                friend bool operator==(executor_type lhs, executor_type rhs) noexcept {
+                    return lhs.pool_ == rhs.pool_;
+                }
+
+                friend bool operator!=(executor_type lhs, executor_type rhs) noexcept {
+                    return !(lhs == rhs);
+                }
+
+            private:
+                thread_pool* pool_;
+        };
+
+        explicit thread_pool(std::size_t threads = std::thread::hardware_concurrency())
+            : queues_{}, threads_{}, mtx_{}, cv_{}, pending_{0u}, next_{0u}, stop_{false} {
+            threads = std::max<std::size_t>(threads, 1u);
+            queues_.reserve(threads);
+            for(std::size_t i = 0u; i < threads; ++i)
+                queues_.push_back(std::make_unique<worker_queue>());
+
+            threads_.reserve(threads);
+            try {
+                for(std::size_t i = 0u; i < threads; ++i)
+                    threads_.emplace_back([this, i] { work(i); });
+            }
+            catch(...) {
+                shutdown();
+                throw;
+            }
+        }
+
+        thread_pool(thread_pool const&) = delete;
+        thread_pool& operator=(thread_pool const&) = delete;
+
+        ~thread_pool() {
+            shutdown();
+        }
+
+        void execute(unique_task task) {
+            std::size_t index = current_pool() == this ?
+                                current_index() :
+                                next_.fetch_add(1u, std::memory_order_relaxed) % queues_.size();
+            /* Counted before being published so that a worker popping the
+             * task never decrements the count below zero */
+            {
+                std::lock_guard<std::mutex> lock{mtx_};
+                pending_.fetch_add(1u, std::memory_order_relaxed);
+            }
+            try {
+                std::lock_guard<std::mutex> lock{queues_[index]->mtx};
+                queues_[index]->tasks.push_back(std::move(task));
+            }
+            catch(...) {
+                std::lock_guard<std::mutex> lock{mtx_};
+                pending_.fetch_sub(1u, std::memory_order_relaxed);
+                throw;
+            }
+            cv_.notify_one();
+        }
+
+        executor_type get_executor() noexcept {
+            return executor_type{*this};
+        }
+
+        std::size_t concurrency() const noexcept {
+            return queues_.size();
+        }
+
+    private:
+        struct alignas(concurrent_detail::cache_line_size) worker_queue {
+            std::mutex mtx{};
+            std::deque<unique_task> tasks{};
+        };
+
+        std::vector<std::unique_ptr<worker_queue>> queues_;
+        std::vector<std::thread> threads_;
+        std::mutex mtx_;
+        std::condition_variable cv_;
+        std::atomic<std::size_t> pending_;
+        std::atomic<std::size_t> next_;
+        bool stop_;
+
+        static thread_pool*& current_pool() noexcept {
+            static thread_local thread_pool* pool = nullptr;
+            return pool;
+        }
+
+        static std::size_t& current_index() noexcept {
+            static thread_local std::size_t index = 0u;
+            return index;
+        }
+
+        void shutdown() noexcept {
+            {
+                std::lock_guard<std::mutex> lock{mtx_};
+                stop_ = true;
+            }
+            cv_.notify_all();
+            for(auto& t : threads_)
+                t.join();
+        }
+
+        bool pop(std::size_t index, unique_task& task) {
+            auto& q = *queues_[index];
+            std::lock_guard<std::mutex> lock{q.mtx};
+            if(q.tasks.empty())
+                return false;
+            task = std::move(q.tasks.back());
+            q.tasks.pop_back();
+            return true;
+        }
+
+        bool steal(std::size_t index, unique_task& task) {
+            for(std::size_t i = 1u; i < queues_.size(); ++i) {
+                auto& q = *queues_[(index + i) % queues_.size()];
+                std::lock_guard<std::mutex> lock{q.mtx};
+                if(q.tasks.empty())
+                    continue;
+                task = std::move(q.tasks.front());
+                q.tasks.pop_front();
+                return true;
+            }
+            return false;
+        }
+
+        void work(std::size_t index) {
+            current_pool() = this;
+            current_index() = index;
+
+            unique_task task;
+            while(true) {
+                if(pop(index, task) || steal(index, task)) {
+                    pending_.fetch_sub(1u, std::memory_order_relaxed);
+                    task();
+                    task = unique_task{};
+                    continue;
+                }
+
+                std::unique_lock<std::mutex> lock{mtx_};
+                cv_.wait(lock, [this] {
+                    return stop_ || pending_.load(std::memory_order_relaxed) > 0u;
+                });
+                if(stop_ && pending_.load(std::memory_order_relaxed) == 0u)
+                    return;
+            }
+        }
+};
+
+struct cancel_on_error_t {
+    explicit cancel_on_error_t() = default;
+};
+
+inline constexpr cancel_on_error_t cancel_on_error{};
+
+namespace concurrent_detail {
+
+template <typename, typename = void>
+struct has_concurrency : std::false_type { };
+
+template <typename Executor>
+struct has_concurrency<Executor, std::void_t<decltype(std::declval<Executor const&>().concurrency())>>
+    : std::true_type { };
+
+template <typename Executor>
+std::size_t concurrency_of(Executor const& ex) noexcept {
+    if constexpr(has_concurrency<Executor>::value)
+        return std::max<std::size_t>(ex.concurrency(), 1u);
+    else
+        return std::max<std::size_t>(std::thread::hardware_concurrency(), 1u);
+}
+
+/* Hands out the blocks of a parallel algorithm. Kept alive by every
+ * submitted task, as tasks starting after all blocks have been claimed
+ * may outlive the algorithm */
+class block_scheduler {
+    public:
+        explicit block_scheduler(std::size_t blocks) noexcept
+            : blocks_{blocks}, next_{0u}, completed_{0u}, mtx_{}, cv_{} { }
+
+        /* Claim and run blocks until none remain. Returns once no
+         * unclaimed blocks are left, not when all claimed blocks have
+         * completed. body must not throw */
+        template <typename Body>
+        void run(Body& body) {
+            std::size_t block;
+            while((block = next_.fetch_add(1u, std::memory_order_relaxed)) < blocks_) {
+                body(block);
+                if(completed_.fetch_add(1u, std::memory_order_acq_rel) + 1u == blocks_) {
+                    std::lock_guard<std::mutex> lock{mtx_};
+                    cv_.notify_all();
+                }
+            }
+        }
+
+        void wait() {
+            std::unique_lock<std::mutex> lock{mtx_};
+            cv_.wait(lock, [this] {
+                return completed_.load(std::memory_order_acquire) == blocks_;
+            });
+        }
+
+    private:
+        std::size_t const blocks_;
+        std::atomic<std::size_t> next_;
+        std::atomic<std::size_t> completed_;
+        std::mutex mtx_;
+        std::condition_variable cv_;
+};
+
+/* Invoke body for each of [0, blocks) on ex and wait for completion.
+ * The calling thread claims blocks too, so the call completes even if
+ * the executor never gets around to the submitted tasks, as may happen
+ * when called from within one of its workers */
+template <typename Executor, typename Body>
+void for_each_block(Executor& ex, std::size_t blocks, Body& body) {
+    auto scheduler = std::make_shared<block_scheduler>(blocks);
+    std::size_t const helpers = std::min(blocks - 1u, concurrency_of(ex));
+    for(std::size_t i = 0u; i < helpers; ++i) {
+        ex.execute([scheduler, &body] {
+            scheduler->run(body);
+        });
+    }
+    scheduler->run(body);
+    scheduler->wait();
+}
+
+/* Number of blocks to split size elements into for ex */
+template <typename Executor>
+std::size_t block_count(Executor const& ex, std::size_t size) noexcept {
+    return std::min(size, concurrency_of(ex) * 4u);
+}
+
+template <typename Range>
+void require_random_access() {
+    using iterator_t = decltype(std::begin(std::declval<Range&>()));
+    static_assert(std::is_base_of_v<std::random_access_iterator_tag,
+                                    typename std::iterator_traits<iterator_t>::iterator_category>,
+                  "Range must be random access");
+}
+
+/* First exception thrown by any block */
+class exception_slot {
+    public:
+        exception_slot() noexcept : mtx_{}, exception_{} { }
+
+        void capture() noexcept {
+            std::lock_guard<std::mutex> lock{mtx_};
+            if(!exception_)
+                exception_ = std::current_exception();
+        }
+
+        void rethrow() const {
+            if(exception_)
+                std::rethrow_exception(exception_);
+        }
+
+    private:
+        std::mutex mtx_;
+        std::exception_ptr exception_;
+};
+
+template <bool Cancel, typename Executor, typename Tasks>
+auto invoke_all(Executor& ex, Tasks& tasks) {
+    using result_t = expected_detail::remove_cvref_t<std::invoke_result_t<decltype(*std::begin(tasks))>>;
+    require_random_access<Tasks>();
+    static_assert(expected_detail::is_expected_v<result_t>, "Tasks must return an expected");
+
+    std::vector<result_t> results;
+    auto const first = std::begin(tasks);
+    std::size_t const size = static_cast<std::size_t>(std::distance(first, std::end(tasks)));
+    if(size == 0u)
+        return results;
+
+    std::vector<std::optional<result_t>> slots(size);
+    std::atomic<bool> cancelled{false};
+    exception_slot exception;
+
+    std::size_t const blocks = block_count(ex, size);
+    std::size_t const block_size = (size + blocks - 1u) / blocks;
+    auto body = [&](std::size_t block) {
+        std::size_t const last = std::min(size, (block + 1u) * block_size);
+        for(std::size_t i = block * block_size; i < last; ++i) {
+            if(cancelled.load(std::memory_order_relaxed))
+                return;
+            try {
+                auto& result = slots[i].emplace(std::invoke(first[i]));
+                if constexpr(Cancel) {
+                    if(!bool(result))
+                        cancelled.store(true, std::memory_order_relaxed);
+                }
+            }
+            catch(...) {
+                exception.capture();
+                cancelled.store(true, std::memory_order_relaxed);
+            }
+        }
+    };
+    for_each_block(ex, blocks, body);
+
+    exception.rethrow();
+
+    results.reserve(size);
+    if constexpr(Cancel) {
+        /* Tasks skipped due to cancellation report the first error by index */
+        auto error = std::find_if(std::begin(slots), std::end(slots), [](auto const& r) {
+            return r && !bool(*r);
+        });
+        for(auto& r : slots) {
+            if(r)
+                results.push_back(std::move(*r));
+            else
+                results.emplace_back(unexpect, (*error)->error());
+        }
+    }
+    else {
+        for(auto& r : slots)
+            results.push_back(std::move(*r));
+    }
+    return results;
+}
+
+/* Partial result of a block in try_transform_reduce, padded to avoid
+ * false sharing between neighbouring blocks */
+template <typename T, typename E>
+struct alignas(cache_line_size) reduce_partial {
+    std::optional<T> value{};
+    std::optional<E> error{};
+};
+
+} /* namespace concurrent_detail */
+
+/* Invoke each of tasks, a random access range of callables returning
+ * expected<T,E>, on ex and collect the results in order. The calling
+ * thread takes part in running the tasks. An exception thrown by a task
+ * is rethrown once all running tasks have finished */
+template <typename Executor, typename Tasks>
+auto parallel_invoke_all(Executor&& ex, Tasks& tasks) {
+    return concurrent_detail::invoke_all<false>(ex, tasks);
+}
+
+/* As above, but tasks not yet started once a task has returned an error
+ * are skipped. Their slots hold a copy of the first error by index */
+template <typename Executor, typename Tasks>
+auto parallel_invoke_all(Executor&& ex, Tasks& tasks, cancel_on_error_t) {
+    return concurrent_detail::invoke_all<true>(ex, tasks);
+}
+
+/* Parallel try_transform_reduce. r is split into blocks reduced into
+ * separate partials on ex, which are then combined in order, starting
+ * from init. reduce must be associative and accept two Ts. Once an
+ * error has been seen, elements past it are skipped, while those before
+ * it are still transformed so that the first error by index is returned
+ * regardless of scheduling */
+template <typename Executor, typename Range, typename T, typename Reduce, typename Transform>
+auto try_transform_reduce(Executor&& ex, Range&& r, T init, Reduce reduce, Transform transform) {
+    using transformed_t = expected_detail::remove_cvref_t<
+        std::invoke_result_t<Transform&, decltype(*std::begin(r))>>;
+    static_assert(expected_detail::is_expected_v<transformed_t>, "Transform must return an expected");
+    concurrent_detail::require_random_access<Range>();
+
+    using error_t = typename transformed_t::error_type;
+    using result_t = expected<T, error_t>;
+    using partial_t = concurrent_detail::reduce_partial<T, error_t>;
+    constexpr std::size_t no_error = static_cast<std::size_t>(-1);
+
+    auto const first = std::begin(r);
+    std::size_t const size = static_cast<std::size_t>(std::distance(first, std::end(r)));
+    if(size == 0u)
+        return result_t(std::in_place, std::move(init));
+
+    std::size_t const blocks = concurrent_detail::block_count(ex, size);
+    std::size_t const block_size = (size + blocks - 1u) / blocks;
+    std::vector<partial_t> partials(blocks);
+    std::atomic<std::size_t> error_index{no_error};
+    concurrent_detail::exception_slot exception;
+
+    auto body = [&](std::size_t block) {
+        auto& partial = partials[block];
+        std::size_t const last = std::min(size, (block + 1u) * block_size);
+        try {
+            for(std::size_t i = block * block_size; i < last; ++i) {
+                if(i > error_index.load(std::memory_order_relaxed))
+                    return;
+
+                auto res = std::invoke(transform, first[i]);
+                if(!bool(res)) {
+                    partial.error.emplace(std::move(res).error());
+                    std::size_t prev = error_index.load(std::memory_order_relaxed);
+                    while(i < prev && !error_index.compare_exchange_weak(prev, i, std::memory_order_relaxed))
+                        ;
+                    return;
+                }
+
+                if(partial.value)
+                    partial.value = std::invoke(reduce, std::move(*partial.value), *std::move(res));
+                else
+                    partial.value.emplace(*std::move(res));
+            }
+        }
+        catch(...) {
+            exception.capture();
+            error_index.store(0u, std::memory_order_relaxed);
+        }
+    };
+    concurrent_detail::for_each_block(ex, blocks, body);
+
+    exception.rethrow();
+
+    /* Blocks are contiguous, so the first block with an error holds the
+     * first error by index */
+    for(auto& partial : partials) {
+        if(partial.error)
+            return result_t(unexpect, std::move(*partial.error));
+    }
+
+    for(auto& partial : partials) {
+        if(partial.value)
+            init = std::invoke(reduce, std::move(init), std::move(*partial.value));
+    }
+    return result_t(std::in_place, std::move(init));
+}
+
+/* Slot for an expected that is set at most once and may then be read
+ * concurrently by any number of threads. Readers of a set slot access
+ * the stored expected in place, without locking. Blocking readers wait
+ * on the state word itself where std::atomic::wait is available, and on
+ * a condition variable otherwise. The slot must not be destroyed while
+ * a set is in progress */
+template <typename T, typename E>
+class atomic_expected {
+    enum state_t : unsigned char {
+        empty,
+        writing,
+        ready
+    };
+
+    public:
+        using value_type = T;
+        using error_type = E;
+
+        atomic_expected() noexcept
+            : state_{empty},
+        #ifndef VIEN_EXPECTED_ATOMIC_WAIT
+              mtx_{}, cv_{},
+        #endif
+              storage_{} { }
+
+        atomic_expected(atomic_expected const&) = delete;
+        atomic_expected& operator=(atomic_expected const&) = delete;
+
+        ~atomic_expected() {
+            if(state_.load(std::memory_order_acquire) == ready)
+                storage_.value.~expected();
+        }
+
+        /* Set the slot, returning false if already set */
+        template <typename... Args>
+        bool set_value(Args&&... args) {
+            if constexpr(std::is_void_v<T>) {
+                static_assert(sizeof...(Args) == 0u, "set_value takes no arguments for void T");
+                return emplace();
+            }
+            else {
+                return emplace(std::in_place, std::forward<Args>(args)...);
+            }
+        }
+
+        template <typename G>
+        bool set_error(G&& g) {
+            return emplace(unexpect, std::forward<G>(g));
+        }
+
+        bool set_result(expected<T,E> r) {
+            return emplace(std::move(r));
+        }
+
+        bool is_ready() const noexcept {
+            return state_.load(std::memory_order_acquire) == ready;
+        }
+
+        void wait() const {
+        #ifdef VIEN_EXPECTED_ATOMIC_WAIT
+            auto state = state_.load(std::memory_order_acquire);
+            while(state != ready) {
+                state_.wait(state, std::memory_order_acquire);
+                state = state_.load(std::memory_order_acquire);
+            }
+        #else
+            if(is_ready())
+                return;
+            std::unique_lock<std::mutex> lock{mtx_};
+            cv_.wait(lock, [this] { return is_ready(); });
+        #endif
+        }
+
+        /* Block until set */
+        expected<T,E> const& get() const {
+            wait();
+            return storage_.value;
+        }
+
+        /* The stored expected, or nullptr if not yet set */
+        expected<T,E> const* try_get() const noexcept {
+            return is_ready() ? std::addressof(storage_.value) : nullptr;
+        }
+
+    private:
+        union storage {
+            storage() noexcept : placeholder{} { }
+            ~storage() { }
+
+            unsigned char placeholder;
+            expected<T,E> value;
+        };
+
+        std::atomic<state_t> state_;
+    #ifndef VIEN_EXPECTED_ATOMIC_WAIT
+        mutable std::mutex mtx_;
+        mutable std::condition_variable cv_;
+    #endif
+        storage storage_;
+
+        template <typename... Args>
+        bool emplace(Args&&... args) {
+            state_t state = empty;
+            if(!state_.compare_exchange_strong(state, writing, std::memory_order_acquire,
+                                               std::memory_order_relaxed))
+                return false;
+
+            try {
+                ::new(std::addressof(storage_.value)) expected<T,E>(std::forward<Args>(args)...);
+            }
+            catch(...) {
+                state_.store(empty, std::memory_order_release);
+                throw;
+            }
+
+        #ifdef VIEN_EXPECTED_ATOMIC_WAIT
+            state_.store(ready, std::memory_order_release);
+            state_.notify_all();
+        #else
+            std::lock_guard<std::mutex> lock{mtx_};
+            state_.store(ready, std::memory_order_release);
+            cv_.notify_all();
+        #endif
+            return true;
+        }
+};
+
+namespace concurrent_detail {
+
+/* Types that fit in a packed_expected next to the discriminant. Default
+ * constructibility is required for decoding into an object */
+template <typename T>
+struct is_packable
+    : std::bool_constant<std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T> &&
+                         sizeof(T) < sizeof(std::uint64_t)> { };
+
+template <>
+struct is_packable<void> : std::true_type { };
+
+template <typename T>
+inline bool constexpr is_packable_v = is_packable<T>::value;
+
+template <typename>
+struct is_unexpected : std::false_type { };
+
+template <typename E>
+struct is_unexpected<unexpected<E>> : std::true_type { };
+
+template <typename T>
+inline bool constexpr is_unexpected_v = is_unexpected<T>::value;
+
+} /* namespace concurrent_detail */
+
+/* expected encoded in a single 64-bit word, for trivially copyable and
+ * default constructible T and E of at most 7 bytes. The discriminant occupies the last byte of
+ * the word and the payload the bytes before it, regardless of byte
+ * order. Being trivially copyable and 8 bytes in size, the type may be
+ * used with lock-free std::atomic, where compare_exchange compares the
+ * object representations */
+template <typename T, typename E>
+class packed_expected {
+    static_assert(concurrent_detail::is_packable_v<T>,
+                  "T must be void or trivially copyable, default constructible and smaller than 8 bytes");
+    static_assert(!std::is_void_v<E> && concurrent_detail::is_packable_v<E>,
+                  "E must be trivially copyable, default constructible and smaller than 8 bytes");
+
+    static constexpr std::size_t tag_offset = sizeof(std::uint64_t) - 1u;
+    static constexpr unsigned char value_tag = 1u;
+    static constexpr unsigned char error_tag = 0u;
+
+    template <typename U>
+    using enable_if_value_ctor_t = std::enable_if_t<
+        !std::is_void_v<T> &&
+        std::is_constructible_v<T, U&&> &&
+        !std::is_same_v<expected_detail::remove_cvref_t<U>, packed_expected> &&
+        !std::is_same_v<expected_detail::remove_cvref_t<U>, std::in_place_t> &&
+        !std::is_same_v<expected_detail::remove_cvref_t<U>, unexpect_t> &&
+        !concurrent_detail::is_unexpected_v<expected_detail::remove_cvref_t<U>> &&
+        !expected_detail::is_expected_v<expected_detail::remove_cvref_t<U>>>;
+
+    public:
+        using value_type = T;
+        using error_type = E;
+        using unexpected_type = unexpected<E>;
+
+        packed_expected() noexcept : word_{0u} {
+            if constexpr(std::is_void_v<T>)
+                word_ = encode<void>(value_tag);
+            else
+                word_ = encode(T{}, value_tag);
+        }
+
+        template <typename U = T, enable_if_value_ctor_t<U>* = nullptr>
+        packed_expected(U&& v) : word_{encode(T(std::forward<U>(v)), value_tag)} { }
+
+        template <typename... Args>
+        explicit packed_expected(std::in_place_t, Args&&... args) : word_{0u} {
+            if constexpr(std::is_void_v<T>) {
+                static_assert(sizeof...(Args) == 0u, "No arguments may be passed for void T");
+                word_ = encode<void>(value_tag);
+            }
+            else {
+                word_ = encode(T(std::forward<Args>(args)...), value_tag);
+            }
+        }
+
+        template <typename... Args>
+        explicit packed_expected(unexpect_t, Args&&... args)
+            : word_{encode(E(std::forward<Args>(args)...), error_tag)} { }
+
+        template <typename G>
+        packed_expected(unexpected<G> const& e) : word_{encode(E(e.value()), error_tag)} { }
+
+        packed_expected(expected<T,E> const& e) : word_{0u} {
+            if(!bool(e))
+                word_ = encode(e.error(), error_tag);
+            else if constexpr(std::is_void_v<T>)
+                word_ = encode<void>(value_tag);
+            else
+                word_ = encode(*e, value_tag);
+        }
+
+        expected<T,E> to_expected() const {
+            if(!has_value())
+                return expected<T,E>(unexpect, error());
+            if constexpr(std::is_void_v<T>)
+                return expected<T,E>();
+            else
+                return expected<T,E>(std::in_place, **this);
+        }
+
+        bool has_value() const noexcept {
+            unsigned char tag;
+            std::memcpy(&tag, reinterpret_cast<unsigned char const*>(&word_) + tag_offset, 1u);
+            return tag == value_tag;
+        }
+
+        explicit operator bool() const noexcept {
+            return has_value();
+        }
+
+        template <typename U = T, std::enable_if_t<!std::is_void_v<U>>* = nullptr>
+        U operator*() const noexcept {
+            return decode<U>();
+        }
+
+        template <typename U = T>
+        std::conditional_t<std::is_void_v<U>, void, U> value() const {
+            if(!has_value())
+                throw bad_expected_access<E>(error());
+            if constexpr(!std::is_void_v<U>)
+                return decode<U>();
+        }
+
+        E error() const noexcept {
+            return decode<E>();
+        }
+
+        template <typename U, typename V = T, std::enable_if_t<!std::is_void_v<V>>* = nullptr>
+        V value_or(U&& u) const {
+            return has_value() ? decode<V>() : static_cast<V>(std::forward<U>(u));
+        }
+
+        /* The monadic functions mirror those of expected. The results must
+         * be packable as well */
+        template <typename F>
+        auto map(F&& f) const {
+            using invoke_t = std::conditional_t<std::is_void_v<T>,
+                                                std::invoke_result<F>,
+                                                std::invoke_result<F, value_t>>;
+            using result_t = packed_expected<std::decay_t<typename invoke_t::type>, E>;
+
+            if(!has_value())
+                return result_t(unexpect, error());
+
+            if constexpr(std::is_void_v<T>) {
+                if constexpr(std::is_void_v<typename result_t::value_type>) {
+                    std::invoke(std::forward<F>(f));
+                    return result_t();
+                }
+                else {
+                    return result_t(std::in_place, std::invoke(std::forward<F>(f)));
+                }
+            }
+            else if constexpr(std::is_void_v<typename result_t::value_type>) {
+                std::invoke(std::forward<F>(f), decode<value_t>());
+                return result_t();
+            }
+            else {
+                return result_t(std::in_place, std::invoke(std::forward<F>(f), decode<value_t>()));
+            }
+        }
+
+        template <typename F>
+        auto map_error(F&& f) const {
+            using result_t = packed_expected<T, std::decay_t<std::invoke_result_t<F, E>>>;
+
+            if(has_value()) {
+                if constexpr(std::is_void_v<T>)
+                    return result_t();
+                else
+                    return result_t(std::in_place, decode<value_t>());
+            }
+            return result_t(unexpect, std::invoke(std::forward<F>(f), error()));
+        }
+
+        template <typename F, typename V = T, std::enable_if_t<!std::is_void_v<V>>* = nullptr>
+        packed_expected and_then(F&& f) const {
+            static_assert(std::is_same_v<V, std::invoke_result_t<F, V>>,
+                          "Callable F must return an instance of type T");
+            return has_value() ? packed_expected(std::in_place, std::invoke(std::forward<F>(f), decode<V>())) :
+                                 *this;
+        }
+
+        template <typename F>
+        packed_expected or_else(F&& f) const {
+            static_assert(std::is_same_v<E, std::invoke_result_t<F, E>>,
+                          "Callable F must return an instance of type E");
+            return has_value() ? *this : packed_expected(unexpect, std::invoke(std::forward<F>(f), error()));
+        }
+
+        friend bool operator==(packed_expected const& lhs, packed_expected const& rhs) noexcept {
+            if(lhs.has_value() != rhs.has_value())
+                return false;
+            if(!lhs.has_value())
+                return lhs.error() == rhs.error();
+            if constexpr(std::is_void_v<T>)
+                return true;
+            else
+                return *lhs == *rhs;
+        }
+
+        friend bool operator!=(packed_expected const& lhs, packed_expected const& rhs) noexcept {
+            return !(lhs == rhs);
+        }
+
+    private:
+        using value_t = std::conditional_t<std::is_void_v<T>, unsigned char, T>;
+
+        alignas(std::uint64_t) std::uint64_t word_;
+
+        template <typename U>
+        static std::uint64_t encode(U const& u, unsigned char tag) noexcept {
+            unsigned char bytes[sizeof(std::uint64_t)]{};
+            std::memcpy(bytes, std::addressof(u), sizeof(U));
+            bytes[tag_offset] = tag;
+            std::uint64_t word;
+            std::memcpy(&word, bytes, sizeof(word));
+            return word;
+        }
+
+        template <typename U, std::enable_if_t<std::is_void_v<U>>* = nullptr>
+        static std::uint64_t encode(unsigned char tag) noexcept {
+            unsigned char bytes[sizeof(std::uint64_t)]{};
+            bytes[tag_offset] = tag;
+            std::uint64_t word;
+            std::memcpy(&word, bytes, sizeof(word));
+            return word;
+        }
+
+        template <typename U>
+        U decode() const noexcept {
+            U u{};
+            std::memcpy(std::addressof(u), &word_, sizeof(U));
+            return u;
+        }
+};
+
+namespace concurrent_detail {
+
+/* Number of read indicators per version of a latest_expected */
+inline constexpr std::size_t reader_shards = 16u;
+
+/* Read indicator shard of the calling thread, assigned round-robin */
+inline std::size_t reader_shard() noexcept {
+    static std::atomic<std::size_t> next{0u};
+    static thread_local std::size_t const shard = next.fetch_add(1u, std::memory_order_relaxed) % reader_shards;
+    return shard;
+}
+
+} /* namespace concurrent_detail */
+
+/* Slot holding the latest published expected, for values republished
+ * far less often than they are read. Based on the left-right technique:
+ * two copies are kept, readers access the active one after announcing
+ * themselves on a read indicator sharded by thread, and the writer updates the inactive
+ * copy, switches readers over to it and waits for readers of the old
+ * copy to leave before updating that one too. Reads are wait-free and
+ * never observe a partially written value, also for types that are not
+ * trivially copyable. Only the writer ever waits */
+template <typename T, typename E>
+class latest_expected {
+    public:
+        using value_type = T;
+        using error_type = E;
+
+        template <typename U = T, std::enable_if_t<std::is_default_constructible_v<U> ||
+                                                   std::is_void_v<U>>* = nullptr>
+        latest_expected() : latest_expected(expected<T,E>()) { }
+
+        explicit latest_expected(expected<T,E> const& initial)
+            : instances_{initial, initial}, active_{0u}, version_{0u}, indicators_{}, writer_mtx_{} { }
+
+        latest_expected(latest_expected const&) = delete;
+        latest_expected& operator=(latest_expected const&) = delete;
+
+        /* Copy of the latest expected */
+        expected<T,E> read() const {
+            return visit([](expected<T,E> const& e) { return e; });
+        }
+
+        /* Invoke f with the latest expected in place. The writer waits
+         * for f to return before reusing the copy passed to it */
+        template <typename F>
+        decltype(auto) visit(F&& f) const {
+            auto& indicator = indicators_[version_.load()][concurrent_detail::reader_shard()].readers;
+            indicator.fetch_add(1u);
+            struct departure {
+                std::atomic<std::size_t>& readers;
+                ~departure() {
+                    readers.fetch_sub(1u);
+                }
+            } guard{indicator};
+
+            return std::invoke(std::forward<F>(f), instances_[active_.load()]);
+        }
+
+        bool has_value() const {
+            return visit([](expected<T,E> const& e) { return e.has_value(); });
+        }
+
+        /* Make e the latest expected. Concurrent publishers are serialized */
+        void publish(expected<T,E> e) {
+            std::lock_guard<std::mutex> lock{writer_mtx_};
+            std::size_t const active = active_.load(std::memory_order_relaxed);
+            instances_[1u - active] = e;
+            active_.store(1u - active);
+
+            std::size_t const version = version_.load(std::memory_order_relaxed);
+            wait_for_readers(1u - version);
+            version_.store(1u - version);
+            wait_for_readers(version);
+
+            instances_[active] = std::move(e);
+        }
+
+    private:
+        struct alignas(concurrent_detail::cache_line_size) read_indicator {
+            std::atomic<std::size_t> readers{0u};
+        };
+
+        /* Readers of each version are spread over separate cache lines */
+        using read_indicators = std::array<read_indicator, concurrent_detail::reader_shards>;
+
+        std::array<expected<T,E>, 2u> instances_;
+        alignas(concurrent_detail::cache_line_size) std::atomic<std::size_t> active_;
+        std::atomic<std::size_t> version_;
+        mutable std::array<read_indicators, 2u> indicators_;
+        std::mutex writer_mtx_;
+
+        void wait_for_readers(std::size_t version) const {
+            for(auto const& shard : indicators_[version]) {
+                while(shard.readers.load() != 0u)
+                    std::this_thread::yield();
+            }
+        }
+};
+
+/* Fallible value computed by f on first access and shared by all threads
+ * thereafter. Once computed, get is a single acquire load followed by an
+ * in-place read; only the first accesses serialize on a mutex while f
+ * runs. Errors are cached like values unless the retry predicate deems
+ * them transient, in which case the error is not stored for good but
+ * handed to the caller invoking f and to every caller that was waiting
+ * for that invocation to finish. Only an access starting after it
+ * invokes f anew, so a failing resource sees one attempt at a time no
+ * matter how many threads are waiting. Should f throw, the exception
+ * propagates to the invoking caller and waiting callers retry */
+template <typename T, typename E, typename F = std::function<expected<T,E>()>>
+class lazy_expected {
+    enum state_t : unsigned char {
+        empty,
+        ready
+    };
+
+    public:
+        using value_type = T;
+        using error_type = E;
+        using reference_type = std::conditional_t<std::is_void_v<T>, void, std::reference_wrapper<T const>>;
+
+        explicit lazy_expected(F f, std::function<bool(E const&)> retry = {})
+            : state_{empty}, failures_{0u}, mtx_{}, f_(std::move(f)), retry_(std::move(retry)),
+              transient_error_{}, storage_{} { }
+
+        lazy_expected(lazy_expected const&) = delete;
+        lazy_expected& operator=(lazy_expected const&) = delete;
+
+        ~lazy_expected() {
+            if(state_.load(std::memory_order_acquire) == ready)
+                storage_.value.~expected();
+        }
+
+        /* Reference to the value, or a copy of the error */
+        expected<reference_type, E> get() {
+            if(state_.load(std::memory_order_acquire) != ready) {
+                std::size_t const failures = failures_.load(std::memory_order_relaxed);
+                std::lock_guard<std::mutex> lock{mtx_};
+                if(state_.load(std::memory_order_relaxed) != ready) {
+                    /* An invocation finished with a transient error while waiting */
+                    if(failures_.load(std::memory_order_relaxed) != failures)
+                        return unexpected(*transient_error_);
+
+                    expected<T,E> r = std::invoke(f_);
+                    if(!r && retry_ && retry_(r.error())) {
+                        transient_error_ = r.error();
+                        failures_.fetch_add(1u, std::memory_order_relaxed);
+                        return unexpected(std::move(r).error());
+                    }
+
+                    ::new(std::addressof(storage_.value)) expected<T,E>(std::move(r));
+                    state_.store(ready, std::memory_order_release);
+                }
+            }
+            return view();
+        }
+
+        bool is_ready() const noexcept {
+            return state_.load(std::memory_order_acquire) == ready;
+        }
+
+    private:
+        union storage {
+            storage() noexcept : placeholder{} { }
+            ~storage() { }
+
+            unsigned char placeholder;
+            expected<T,E> value;
+        };
+
+        std::atomic<state_t> state_;
+        std::atomic<std::size_t> failures_;
+        std::mutex mtx_;
+        F f_;
+        std::function<bool(E const&)> retry_;
+        std::optional<E> transient_error_;
+        storage storage_;
+
+        expected<reference_type, E> view() const {
+            expected<T,E> const& e = storage_.value;
+            if(!e)
+                return unexpected(e.error());
+            if constexpr(std::is_void_v<T>)
+                return {};
+            else
+                return std::cref(*e);
+        }
+};
+
+template <typename F>
+lazy_expected(F) -> lazy_expected<typename expected_detail::remove_cvref_t<std::invoke_result_t<F&>>::value_type,
+                                  typename expected_detail::remove_cvref_t<std::invoke_result_t<F&>>::error_type,
+                                  F>;
+
+template <typename F, typename R>
+lazy_expected(F, R) -> lazy_expected<typename expected_detail::remove_cvref_t<std::invoke_result_t<F&>>::value_type,
+                                     typename expected_detail::remove_cvref_t<std::invoke_result_t<F&>>::error_type,
+                                     F>;
+
+/* Immutable expected shared between owners through an atomic reference
+ * count, like std::shared_ptr<expected<T,E> const> but with the count
+ * and the expected in a single allocation and without the pointer's
+ * null state. Copies share the expected; moved-from instances may only
+ * be assigned to or destroyed. The monadic functions operate on the
+ * shared expected and return unshared expecteds */
+template <typename T, typename E>
+class shared_expected {
+    public:
+        using value_type = T;
+        using error_type = E;
+
+        shared_expected(expected<T,E> e) : block_{new control_block(std::move(e))} { }
+
+        template <typename... Args>
+        explicit shared_expected(std::in_place_t, Args&&... args)
+            : block_{new control_block(expected<T,E>(std::in_place, std::forward<Args>(args)...))} { }
+
+        template <typename... Args>
+        explicit shared_expected(unexpect_t, Args&&... args)
+            : block_{new control_block(expected<T,E>(unexpect, std::forward<Args>(args)...))} { }
+
+        shared_expected(shared_expected const& other) noexcept : block_{other.block_} {
+            block_->refs.fetch_add(1u, std::memory_order_relaxed);
+        }
+
+        shared_expected(shared_expected&& other) noexcept : block_{std::exchange(other.block_, nullptr)} { }
+
+        ~shared_expected() {
+            release();
+        }
+
+        shared_expected& operator=(shared_expected const& other) noexcept {
+            if(block_ != other.block_) {
+                other.block_->refs.fetch_add(1u, std::memory_order_relaxed);
+                release();
+                block_ = other.block_;
+            }
+            return *this;
+        }
+
+        shared_expected& operator=(shared_expected&& other) noexcept {
+            if(this != &other) {
+                release();
+                block_ = std::exchange(other.block_, nullptr);
+            }
+            return *this;
+        }
+
+        expected<T,E> const& get() const noexcept {
+            return block_->value;
+        }
+
+        std::size_t use_count() const noexcept {
+            return block_->refs.load(std::memory_order_relaxed);
+        }
+
+        auto operator->() const {
+            return get().operator->();
+        }
+
+        decltype(auto) operator*() const {
+            return *get();
+        }
+
+        explicit operator bool() const noexcept {
+            return get().has_value();
+        }
+
+        bool has_value() const noexcept {
+            return get().has_value();
+        }
+
+        decltype(auto) value() const {
+            return get().value();
+        }
+
+        E const& error() const {
+            return get().error();
+        }
+
+        template <typename U>
+        T value_or(U&& u) const {
+            return get().value_or(std::forward<U>(u));
+        }
+
+        template <typename F>
+        auto map(F&& f) const {
+            return get().map(std::forward<F>(f));
+        }
+
+        template <typename F>
+        auto map_error(F&& f) const {
+            return get().map_error(std::forward<F>(f));
+        }
+
+        template <typename F>
+        expected<T,E> and_then(F&& f) const {
+            return get().and_then(std::forward<F>(f));
+        }
+
+        template <typename F>
+        expected<T,E> or_else(F&& f) const {
+            return get().or_else(std::forward<F>(f));
+        }
+
+    private:
+        struct control_block {
+            explicit control_block(expected<T,E>&& e) : refs{1u}, value(std::move(e)) { }
+
+            std::atomic<std::size_t> refs;
+            expected<T,E> const value;
+        };
+
+        control_block* block_;
+
+        void release() noexcept {
+            if(block_ && block_->refs.fetch_sub(1u, std::memory_order_acq_rel) == 1u)
+                delete block_;
+        }
+};
+
+/* Bounded multi-producer multi-consumer queue of expecteds, following
+ * Vyukov's array-based design: each cell carries a sequence number
+ * telling producers and consumers whether it is free or filled, so that
+ * pushing and popping amount to a compare-exchange on the enqueue or
+ * dequeue position. The positions are kept on separate cache lines.
+ * Batched pops claim a run of filled cells with a single compare-exchange.
+ *
+ * Closing the channel with an error sets a bit in the enqueue position,
+ * so that a push either claims its cell before the channel is closed or
+ * fails. Closing wakes all consumers blocked in pop. Consumers are handed
+ * the error only once every cell claimed before the close has been
+ * published and popped. The mutex and condition variable are touched
+ * only by consumers about to block and by producers that observe such
+ * consumers */
+template <typename T, typename E>
+class expected_channel {
+    static_assert(std::is_nothrow_move_constructible_v<expected<T,E>>,
+                  "expected_channel requires nothrow move constructible value and error types");
+
+    static constexpr std::size_t closed_bit = ~(~std::size_t{0u} >> 1u);
+
+    public:
+        using value_type = T;
+        using error_type = E;
+
+        /* Capacity is rounded up to a power of two */
+        explicit expected_channel(std::size_t capacity)
+            : mask_{ceil_pow2(capacity) - 1u}, cells_{new cell[mask_ + 1u]}, enqueue_pos_{0u},
+              dequeue_pos_{0u}, waiters_{0u}, mtx_{}, cv_{}, error_{} {
+            for(std::size_t i = 0u; i <= mask_; ++i)
+                cells_[i].seq.store(i, std::memory_order_relaxed);
+        }
+
+        expected_channel(expected_channel const&) = delete;
+        expected_channel& operator=(expected_channel const&) = delete;
+
+        ~expected_channel() {
+            std::size_t const end = enqueue_pos_.load(std::memory_order_relaxed) & ~closed_bit;
+            for(std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed); pos != end; ++pos) {
+                cell& c = cells_[pos & mask_];
+                if(c.seq.load(std::memory_order_acquire) == pos + 1u)
+                    c.storage.value.~expected();
+            }
+        }
+
+        std::size_t capacity() const noexcept {
+            return mask_ + 1u;
+        }
+
+        bool is_closed() const noexcept {
+            return (enqueue_pos_.load(std::memory_order_acquire) & closed_bit) != 0u;
+        }
+
+        /* Push e unless the channel is full or closed. e is left untouched
+         * on failure */
+        bool try_push(expected<T,E>&& e) {
+            std::size_t pos = enqueue_pos_.load(std::memory_order_relaxed);
+            cell* c;
+            while(true) {
+                if(pos & closed_bit)
+                    return false;
+
+                c = &cells_[pos & mask_];
+                std::size_t const seq = c->seq.load(std::memory_order_acquire);
+                auto const diff = static_cast<std::ptrdiff_t>(seq - pos);
+                if(diff == 0) {
+                    if(enqueue_pos_.compare_exchange_weak(pos, pos + 1u, std::memory_order_relaxed))
+                        break;
+                }
+                else if(diff < 0) {
+                    return false;
+                }
+                else {
+                    pos = enqueue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+
+            ::new(std::addressof(c->storage.value)) expected<T,E>(std::move(e));
+            c->seq.store(pos + 1u, std::memory_order_release);
+            wake_consumer();
+            return true;
+        }
+
+        bool try_push(expected<T,E> const& e) {
+            return try_push(expected<T,E>(e));
+        }
+
+        /* Pop the front element without blocking. Returns an expected
+         * holding the close error once the channel is closed and drained,
+         * and nullopt if no element is available otherwise */
+        std::optional<expected<T,E>> try_pop() {
+            std::optional<expected<T,E>> r;
+            auto sink = [&r](expected<T,E>&& e) {
+                r.emplace(std::move(e));
+            };
+            if(dequeue(1u, sink) == 0u && drained())
+                r.emplace(unexpect, *error_);
+            return r;
+        }
+
+        /* Pop up to max elements into out without blocking, returning the
+         * number popped, or the close error once the channel is closed and
+         * drained. Should assignment through out throw, the elements of the
+         * batch not yet written are dropped */
+        template <typename OutputIt>
+        expected<std::size_t, E> try_pop_batch(OutputIt out, std::size_t max) {
+            auto sink = [&out](expected<T,E>&& e) {
+                *out = std::move(e);
+                ++out;
+            };
+            std::size_t const n = dequeue(max, sink);
+            if(n == 0u && max != 0u && drained())
+                return unexpected(*error_);
+            return n;
+        }
+
+        /* Pop the front element, blocking while none is available and the
+         * channel is not drained. Returns the close error once the channel is closed and
+         * drained */
+        expected<T,E> pop() {
+            while(true) {
+                if(auto r = try_pop())
+                    return std::move(*r);
+
+                std::unique_lock<std::mutex> lock{mtx_};
+                waiters_.fetch_add(1u);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                cv_.wait(lock, [this] { return readable() || drained(); });
+                waiters_.fetch_sub(1u);
+            }
+        }
+
+        /* Close the channel, returning false if it was already closed */
+        bool close(E e) {
+            std::lock_guard<std::mutex> lock{mtx_};
+            if(is_closed())
+                return false;
+            error_.emplace(std::move(e));
+            enqueue_pos_.fetch_or(closed_bit, std::memory_order_acq_rel);
+            cv_.notify_all();
+            return true;
+        }
+
+    private:
+        struct cell {
+            union storage_t {
+                storage_t() noexcept : placeholder{} { }
+                ~storage_t() { }
+
+                unsigned char placeholder;
+                expected<T,E> value;
+            };
+
+            cell() noexcept : seq{0u}, storage{} { }
+
+            std::atomic<std::size_t> seq;
+            storage_t storage;
+        };
+
+        std::size_t const mask_;
+        std::unique_ptr<cell[]> const cells_;
+        alignas(concurrent_detail::cache_line_size) std::atomic<std::size_t> enqueue_pos_;
+        alignas(concurrent_detail::cache_line_size) std::atomic<std::size_t> dequeue_pos_;
+        alignas(concurrent_detail::cache_line_size) std::atomic<std::size_t> waiters_;
+        std::mutex mtx_;
+        std::condition_variable cv_;
+        std::optional<E> error_;
+
+        static std::size_t ceil_pow2(std::size_t n) noexcept {
+            std::size_t p = 2u;
+            while(p < n)
+                p <<= 1u;
+            return p;
+        }
+
+        bool readable() const noexcept {
+            std::size_t const pos = dequeue_pos_.load(std::memory_order_relaxed);
+            return cells_[pos & mask_].seq.load(std::memory_order_acquire) == pos + 1u;
+        }
+
+        /* True iff the channel is closed and every element pushed before
+         * has been popped */
+        bool drained() const noexcept {
+            std::size_t const end = enqueue_pos_.load(std::memory_order_acquire);
+            return (end & closed_bit) != 0u &&
+                   dequeue_pos_.load(std::memory_order_relaxed) == (end & ~closed_bit);
+        }
+
+        /* Wake a consumer blocked in pop after publishing an element, or
+         * all of them if the channel is closed, as the element may be the
+         * last one they are waiting for before the channel is drained */
+        void wake_consumer() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(waiters_.load(std::memory_order_relaxed) != 0u) {
+                std::lock_guard<std::mutex> lock{mtx_};
+                if(is_closed())
+                    cv_.notify_all();
+                else
+                    cv_.notify_one();
+            }
+        }
+
+        void wake_all_consumers() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if(waiters_.load(std::memory_order_relaxed) != 0u) {
+                std::lock_guard<std::mutex> lock{mtx_};
+                cv_.notify_all();
+            }
+        }
+
+        /* Claim up to max consecutive filled cells and pass their elements
+         * to sink in order */
+        template <typename Sink>
+        std::size_t dequeue(std::size_t max, Sink& sink) {
+            max = std::min(max, capacity());
+            std::size_t pos = dequeue_pos_.load(std::memory_order_relaxed);
+            std::size_t n;
+            while(true) {
+                n = 0u;
+                std::size_t seq = 0u;
+                for(; n < max; ++n) {
+                    seq = cells_[(pos + n) & mask_].seq.load(std::memory_order_acquire);
+                    if(seq != pos + n + 1u)
+                        break;
+                }
+
+                if(n != 0u) {
+                    if(dequeue_pos_.compare_exchange_weak(pos, pos + n, std::memory_order_relaxed))
+                        break;
+                }
+                else if(max == 0u || static_cast<std::ptrdiff_t>(seq - (pos + 1u)) < 0) {
+                    return 0u;
+                }
+                else {
+                    pos = dequeue_pos_.load(std::memory_order_relaxed);
+                }
+            }
+
+            /* Popped the last element of a closed channel */
+            if(enqueue_pos_.load(std::memory_order_acquire) == ((pos + n) | closed_bit))
+                wake_all_consumers();
+
+            std::size_t i = 0u;
+            try {
+                for(; i < n; ++i) {
+                    cell& c = cells_[(pos + i) & mask_];
+                    sink(std::move(c.storage.value));
+                    release(c, pos + i);
+                }
+            }
+            catch(...) {
+                for(; i < n; ++i)
+                    release(cells_[(pos + i) & mask_], pos + i);
+                throw;
+            }
+            return n;
+        }
+
+        void release(cell& c, std::size_t pos) noexcept {
+            c.storage.value.~expected();
+            c.seq.store(pos + mask_ + 1u, std::memory_order_release);
+        }
+};
+
+/* Minimal single-threaded execution context in the style of P2300.
+ * Operations scheduled on it run on whichever thread calls run, in
+ * the order they were scheduled */
+class run_loop {
+    struct task_base {
+        task_base() noexcept = default;
+        task_base(task_base const&) = delete;
+        task_base& operator=(task_base const&) = delete;
+
+        virtual void execute() = 0;
+
+        task_base* next{nullptr};
+
+        protected:
+            ~task_base() = default;
+    };
+
+    template <typename Receiver>
+    class schedule_operation final : task_base {
+        public:
+            schedule_operation(run_loop& loop, Receiver r)
+                : task_base{}, loop_{&loop}, r_{std::move(r)} { }
+
+            void start() {
+                loop_->push(this);
+            }
+
+        private:
+            run_loop* loop_;
+            Receiver r_;
+
+            void execute() override {
+                r_.set_value();
+            }
+    };
+
+    public:
+        class schedule_sender {
+            public:
+                using value_type = void;
+                using error_type = void;
+
+                explicit schedule_sender(run_loop& loop) noexcept : loop_{&loop} { }
+
+                template <typename Receiver>
+                schedule_operation<Receiver> connect(Receiver r) && {
+                    return schedule_operation<Receiver>(*loop_, std::move(r));
+                }
+
+            private:
+                run_loop* loop_;
+        };
+
+        class scheduler {
+            public:
+                explicit scheduler(run_loop& loop) noexcept : loop_{&loop} { }
+
+                schedule_sender schedule() const noexcept {
+                    return schedule_sender{*loop_};
+                }
+
+                friend bool operator==(scheduler lhs, scheduler rhs) noexcept {
+                    return lhs.loop_ == rhs.loop_;
+                }
+
+                friend bool operator!=(scheduler lhs, scheduler rhs) noexcept {
+                    return !(lhs == rhs);
+                }
+
+            private:
+                run_loop* loop_;
+        };
+
+        run_loop() noexcept : mtx_{}, cv_{}, head_{nullptr}, tail_{nullptr}, finishing_{false} { }
+        run_loop(run_loop const&) = delete;
+        run_loop& operator=(run_loop const&) = delete;
+
+        scheduler get_scheduler() noexcept {
+            return scheduler{*this};
+        }
+
+        /* Run scheduled operations until finish has been called and
+         * no operations remain. Exceptions thrown while completing an
+         * operation propagate from here */
+        void run() {
+            while(task_base* task = pop())
+                task->execute();
+        }
+
+        /* Notifies under the lock, as the loop may be destroyed as soon as
+         * run returns */
+        void finish() {
+            std::lock_guard<std::mutex> lock{mtx_};
+            finishing_ = true;
+            cv_.notify_all();
+        }
+
+    private:
+        std::mutex mtx_;
+        std::condition_variable cv_;
+        task_base* head_;
+        task_base* tail_;
+        bool finishing_;
+
+        void push(task_base* task) {
+            {
+                std::lock_guard<std::mutex> lock{mtx_};
+                if(tail_)
+                    tail_->next = task;
+                else
+                    head_ = task;
+                tail_ = task;
+            }
+            cv_.notify_one();
+        }
+
+        task_base* pop() {
+            std::unique_lock<std::mutex> lock{mtx_};
+            cv_.wait(lock, [this] { return head_ || finishing_; });
+            task_base* task = head_;
+            if(task) {
+                head_ = task->next;
+                if(!head_)
+                    tail_ = nullptr;
+            }
+            return task;
+        }
+};
+
+namespace concurrent_detail {
+
+using expected_detail::remove_cvref_t;
+using expected_detail::type_is;
+
+/* Error type of a sender combining completions with errors E1 and E2.
+ * void means no errors are sent. E1 must be convertible to E2 */
+template <typename E1, typename E2>
+struct merged_error : type_is<E2> {
+    static_assert(std::is_constructible_v<E2, E1>, "Error types must be convertible");
+};
+
+template <typename E1>
+struct merged_error<E1, void> : type_is<E1> { };
+
+template <typename E2>
+struct merged_error<void, E2> : type_is<E2> { };
+
+template <>
+struct merged_error<void, void> : type_is<void> { };
+
+template <typename E1, typename E2>
+using merged_error_t = typename merged_error<E1,E2>::type;
+
+template <typename Sender, typename Receiver>
+using operation_t = decltype(std::declval<Sender>().connect(std::declval<Receiver>()));
+
+template <typename Sender, typename F>
+using then_result_t = std::conditional_t<
+    std::is_void_v<typename Sender::value_type>,
+    std::invoke_result<F>,
+    std::invoke_result<F, typename Sender::value_type>>;
+
+/* Complete r with the value or error of e */
+template <typename Error, typename Receiver, typename Exp>
+void complete_with(Receiver& r, Exp&& e) {
+    if(!bool(e))
+        r.set_error(Error(std::forward<Exp>(e).error()));
+    else if constexpr(std::is_void_v<typename remove_cvref_t<Exp>::value_type>)
+        r.set_value();
+    else
+        r.set_value(*std::forward<Exp>(e));
+}
+
+/* Converts to the result of invoking f, allowing non-movable operation
+ * states to be emplaced into optionals */
+template <typename F>
+struct emplacer {
+    F f;
+
+    operator std::invoke_result_t<F>() {
+        return std::invoke(f);
+    }
+};
+
+template <typename F>
+emplacer(F) -> emplacer<F>;
+
+template <typename T, typename E>
+class as_sender_operation {
+    public:
+        template <typename Receiver>
+        class type {
+            public:
+                type(expected<T,E> e, Receiver r) : e_{std::move(e)}, r_{std::move(r)} { }
+                type(type const&) = delete;
+                type& operator=(type const&) = delete;
+
+                void start() {
+                    complete_with<E>(r_, std::move(e_));
+                }
+
+            private:
+                expected<T,E> e_;
+                Receiver r_;
+        };
+};
+
+template <typename Sender, typename F, typename Receiver>
+class then_expected_operation {
+    using fn_result_t = remove_cvref_t<typename then_result_t<Sender, F>::type>;
+    using error_t = merged_error_t<typename Sender::error_type, typename fn_result_t::error_type>;
+
+    struct receiver {
+        then_expected_operation* op;
+
+        template <typename... Vs>
+        void set_value(Vs&&... vs) {
+            complete_with<error_t>(op->r_, std::invoke(std::move(op->f_), std::forward<Vs>(vs)...));
+        }
+
+        template <typename G>
+        void set_error(G&& g) {
+            op->r_.set_error(error_t(std::forward<G>(g)));
+        }
+
+        void set_stopped() {
+            op->r_.set_stopped();
+        }
+    };
+
+    public:
+        then_expected_operation(Sender&& s, F f, Receiver r)
+            : f_{std::move(f)}, r_{std::move(r)}, op_{std::move(s).connect(receiver{this})} { }
+        then_expected_operation(then_expected_operation const&) = delete;
+        then_expected_operation& operator=(then_expected_operation const&) = delete;
+
+        void start() {
+            op_.start();
+        }
+
+    private:
+        F f_;
+        Receiver r_;
+        operation_t<Sender, receiver> op_;
+};
+
+template <typename Sender, typename F>
+using let_sender_t = remove_cvref_t<typename then_result_t<Sender, F>::type>;
+
+template <typename Sender, typename F, typename Receiver>
+class let_expected_operation {
+    using value_t = typename Sender::value_type;
+    using next_sender_t = let_sender_t<Sender, F>;
+    using error_t = merged_error_t<typename Sender::error_type, typename next_sender_t::error_type>;
+
+    /* Receives the completion of the sender returned by f */
+    struct next_receiver {
+        let_expected_operation* op;
+
+        template <typename... Vs>
+        void set_value(Vs&&... vs) {
+            op->r_.set_value(std::forward<Vs>(vs)...);
+        }
+
+        template <typename G>
+        void set_error(G&& g) {
+            op->r_.set_error(error_t(std::forward<G>(g)));
+        }
+
+        void set_stopped() {
+            op->r_.set_stopped();
+        }
+    };
+
+    struct receiver {
+        let_expected_operation* op;
+
+        template <typename... Vs>
+        void set_value(Vs&&... vs) {
+            op->start_next(std::forward<Vs>(vs)...);
+        }
+
+        template <typename G>
+        void set_error(G&& g) {
+            op->r_.set_error(error_t(std::forward<G>(g)));
+        }
+
+        void set_stopped() {
+            op->r_.set_stopped();
+        }
+    };
+
+    using stored_value_t = std::conditional_t<std::is_void_v<value_t>, std::monostate, value_t>;
+
+    public:
+        let_expected_operation(Sender&& s, F f, Receiver r)
+            : f_{std::move(f)}, r_{std::move(r)}, value_{}, next_{},
+              op_{std::move(s).connect(receiver{this})} { }
+        let_expected_operation(let_expected_operation const&) = delete;
+        let_expected_operation& operator=(let_expected_operation const&) = delete;
+
+        void start() {
+            op_.start();
+        }
+
+    private:
+        F f_;
+        Receiver r_;
+        /* Kept alive for the duration of the sender returned by f */
+        std::optional<stored_value_t> value_;
+        std::optional<operation_t<next_sender_t, next_receiver>> next_;
+        operation_t<Sender, receiver> op_;
+
+        template <typename... Vs>
+        void start_next(Vs&&... vs) {
+            next_.emplace(emplacer{[this, &vs...] {
+                if constexpr(std::is_void_v<value_t>) {
+                    return std::invoke(std::move(f_)).connect(next_receiver{this});
+                }
+                else {
+                    auto& v = value_.emplace(std::forward<Vs>(vs)...);
+                    return std::invoke(std::move(f_), v).connect(next_receiver{this});
+                }
+            }});
+            next_->start();
+        }
+};
+
+template <typename Sender, typename Receiver>
+class into_expected_operation {
+    using value_t = typename Sender::value_type;
+    using error_t = typename Sender::error_type;
+    using result_t = expected<value_t, error_t>;
+
+    struct receiver {
+        into_expected_operation* op;
+
+        template <typename... Vs>
+        void set_value(Vs&&... vs) {
+            op->r_.set_value(result_t(std::in_place, std::forward<Vs>(vs)...));
+        }
+
+        template <typename G>
+        void set_error(G&& g) {
+            op->r_.set_value(result_t(unexpect, std::forward<G>(g)));
+        }
+
+        void set_stopped() {
+            op->r_.set_stopped();
+        }
+    };
+
+    public:
+        into_expected_operation(Sender&& s, Receiver r)
+            : r_{std::move(r)}, op_{std::move(s).connect(receiver{this})} { }
+        into_expected_operation(into_expected_operation const&) = delete;
+        into_expected_operation& operator=(into_expected_operation const&) = delete;
+
+        void start() {
+            op_.start();
+        }
+
+    private:
+        Receiver r_;
+        operation_t<Sender, receiver> op_;
+};
+
+/* Receiver of sync_wait_expected, storing the result and stopping the
+ * loop driving the wait */
+template <typename T, typename E>
+struct sync_wait_receiver {
+    std::optional<expected<T,E>>* result;
+    run_loop* loop;
+
+    template <typename... Vs>
+    void set_value(Vs&&... vs) {
+        result->emplace(std::in_place, std::forward<Vs>(vs)...);
+        loop->finish();
+    }
+
+    template <typename G>
+    void set_error(G&& g) {
+        result->emplace(unexpect, std::forward<G>(g));
+        loop->finish();
+    }
+
+    void set_stopped() {
+        loop->finish();
+    }
+};
+
+} /* namespace concurrent_detail */
+
+/* Sender completing inline with the value or error of an expected */
+template <typename T, typename E>
+class as_sender_t {
+    public:
+        using value_type = T;
+        using error_type = E;
+
+        explicit as_sender_t(expected<T,E> e) : e_{std::move(e)} { }
+
+        template <typename Receiver>
+        auto connect(Receiver r) && {
+            using operation_t =
+                typename concurrent_detail::as_sender_operation<T,E>::template type<Receiver>;
+            return operation_t(std::move(e_), std::move(r));
+        }
+
+    private:
+        expected<T,E> e_;
+};
+
+template <typename T, typename E>
+as_sender_t<T,E> as_sender(expected<T,E> e) {
+    return as_sender_t<T,E>(std::move(e));
+}
+
+/* Sender invoking f with the value of s. The value or error of the
+ * expected returned by f is sent on the corresponding channel rather
+ * than wrapped in the value channel */
+template <typename Sender, typename F>
+class then_expected_sender {
+    using fn_result_t = expected_detail::remove_cvref_t<
+        typename concurrent_detail::then_result_t<Sender, F>::type>;
+    static_assert(expected_detail::is_expected_v<fn_result_t>, "F must return an expected");
+
+    public:
+        using value_type = typename fn_result_t::value_type;
+        using error_type =
+            concurrent_detail::merged_error_t<typename Sender::error_type, typename fn_result_t::error_type>;
+
+        then_expected_sender(Sender s, F f) : s_{std::move(s)}, f_{std::move(f)} { }
+
+        template <typename Receiver>
+        concurrent_detail::then_expected_operation<Sender, F, Receiver> connect(Receiver r) && {
+            return concurrent_detail::then_expected_operation<Sender, F, Receiver>(
+                std::move(s_), std::move(f_), std::move(r));
+        }
+
+    private:
+        Sender s_;
+        F f_;
+};
+
+template <typename Sender, typename F>
+then_expected_sender<std::decay_t<Sender>, std::decay_t<F>> then_expected(Sender&& s, F&& f) {
+    return {std::forward<Sender>(s), std::forward<F>(f)};
+}
+
+/* Sender invoking f with the value of s and completing as the sender
+ * returned by f. The value passed to f lives until that sender has
+ * completed */
+template <typename Sender, typename F>
+class let_expected_sender {
+    using next_sender_t = concurrent_detail::let_sender_t<Sender, F>;
+
+    public:
+        using value_type = typename next_sender_t::value_type;
+        using error_type =
+            concurrent_detail::merged_error_t<typename Sender::error_type, typename next_sender_t::error_type>;
+
+        let_expected_sender(Sender s, F f) : s_{std::move(s)}, f_{std::move(f)} { }
+
+        template <typename Receiver>
+        concurrent_detail::let_expected_operation<Sender, F, Receiver> connect(Receiver r) && {
+            return concurrent_detail::let_expected_operation<Sender, F, Receiver>(
+                std::move(s_), std::move(f_), std::move(r));
+        }
+
+    private:
+        Sender s_;
+        F f_;
+};
+
+template <typename Sender, typename F>
+let_expected_sender<std::decay_t<Sender>, std::decay_t<F>> let_expected(Sender&& s, F&& f) {
+    return {std::forward<Sender>(s), std::forward<F>(f)};
+}
+
+/* Sender sending the completion of s as an expected on the value
+ * channel, for consumers expecting errors in band */
+template <typename Sender>
+class into_expected_sender {
+    public:
+        using value_type = expected<typename Sender::value_type, typename Sender::error_type>;
+        using error_type = void;
+
+        explicit into_expected_sender(Sender s) : s_{std::move(s)} { }
+
+        template <typename Receiver>
+        concurrent_detail::into_expected_operation<Sender, Receiver> connect(Receiver r) && {
+            return concurrent_detail::into_expected_operation<Sender, Receiver>(std::move(s_), std::move(r));
+        }
+
+    private:
+        Sender s_;
+};
+
+template <typename Sender>
+into_expected_sender<std::decay_t<Sender>> into_expected(Sender&& s) {
+    return into_expected_sender<std::decay_t<Sender>>(std::forward<Sender>(s));
+}
+
+/* Start s and block until it completes, driving a local run_loop in
+ * the meantime. Returns an empty optional if s was stopped */
+template <typename Sender>
+auto sync_wait_expected(Sender&& s) {
+    using sender_t = std::decay_t<Sender>;
+    using value_t = typename sender_t::value_type;
+    using error_t = typename sender_t::error_type;
+    static_assert(!std::is_void_v<error_t>, "Sender must have an error channel");
+
+    std::optional<expected<value_t, error_t>> result;
+    run_loop loop;
+    auto op = sender_t(std::forward<Sender>(s)).connect(
+        concurrent_detail::sync_wait_receiver<value_t, error_t>{&result, &loop});
+    op.start();
+    loop.run();
+    return result;
+}
+
+} /* namespace v1 */
+} /* namespace vien */
+
+#endif
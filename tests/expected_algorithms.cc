@@ -0,0 +1,275 @@
+#ifndef EXPECTED_MANUAL_TEST
+#define VIEN_EXPECTED_EXTENDED
+#include "catch.hpp"
+#include "expected.h"
+#include <forward_list>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <set>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using vien::unexpect;
+
+TEST_CASE("collect gathers values", "[expected][extended][algorithms][collect]") {
+    std::vector<vien::expected<int, std::string>> v{1, 2, 3};
+
+    auto e1 = vien::collect<std::vector<int>>(std::begin(v), std::end(v));
+
+    REQUIRE(std::is_same_v<decltype(e1), vien::expected<std::vector<int>, std::string>>);
+    REQUIRE(e1 == std::vector<int>{1, 2, 3});
+    REQUIRE(e1->capacity() == 3u);
+
+    auto e2 = vien::collect<std::set<int>>(v);
+
+    REQUIRE(e2 == std::set<int>{1, 2, 3});
+
+    std::forward_list<vien::expected<int, std::string>> l{1, 2};
+    auto e3 = vien::collect<std::vector<int>>(std::begin(l), std::end(l));
+
+    REQUIRE(e3 == std::vector<int>{1, 2});
+}
+
+TEST_CASE("collect short-circuits on first error", "[expected][extended][algorithms][collect]") {
+    std::vector<vien::expected<int, std::string>> v{0, 1, vien::unexpected(std::string("2")),
+                                                    vien::unexpected(std::string("3"))};
+
+    auto e1 = vien::collect<std::vector<int>>(v);
+
+    REQUIRE(e1 == vien::unexpected(std::string("2")));
+}
+
+TEST_CASE("collect moves from rvalue range", "[expected][extended][algorithms][collect]") {
+    std::vector<vien::expected<std::unique_ptr<int>, int>> v;
+    v.emplace_back(std::make_unique<int>(1));
+    v.emplace_back(std::make_unique<int>(2));
+
+    auto e1 = vien::collect<std::vector<std::unique_ptr<int>>>(std::move(v));
+
+    REQUIRE(bool(e1));
+    REQUIRE(e1->size() == 2u);
+    REQUIRE(*(*e1)[1] == 2);
+
+    std::vector<vien::expected<std::unique_ptr<int>, int>> v2;
+    v2.emplace_back(std::make_unique<int>(1));
+    v2.emplace_back(unexpect, 5);
+
+    auto e2 = vien::collect<std::vector<std::unique_ptr<int>>>(std::move(v2));
+
+    REQUIRE(e2 == vien::unexpected(5));
+}
+
+TEST_CASE("partition_results splits values and errors", "[expected][extended][algorithms][partition_results]") {
+    std::vector<vien::expected<int, std::string>> v{1, vien::unexpected(std::string("a")), 2,
+                                                    vien::unexpected(std::string("b")), 3};
+
+    std::vector<int> values;
+    std::vector<std::string> errors;
+    auto counts = vien::partition_results(v, values, errors);
+
+    REQUIRE(counts.values == 3u);
+    REQUIRE(counts.errors == 2u);
+    REQUIRE(values == std::vector<int>{1, 2, 3});
+    REQUIRE(values.capacity() >= v.size());
+    REQUIRE(errors == std::vector<std::string>{"a", "b"});
+
+    std::set<int> value_set;
+    std::vector<std::string> errors2;
+    counts = vien::partition_results(v, value_set, std::back_inserter(errors2));
+
+    REQUIRE(counts.values == 3u);
+    REQUIRE(value_set == std::set<int>{1, 2, 3});
+    REQUIRE(errors2 == errors);
+}
+
+TEST_CASE("partition_results moves from rvalue range", "[expected][extended][algorithms][partition_results]") {
+    std::vector<vien::expected<std::unique_ptr<int>, std::unique_ptr<int>>> v;
+    v.emplace_back(std::make_unique<int>(1));
+    v.emplace_back(unexpect, std::make_unique<int>(2));
+
+    std::vector<std::unique_ptr<int>> values;
+    std::vector<std::unique_ptr<int>> errors;
+    auto counts = vien::partition_results(std::move(v), values, errors);
+
+    REQUIRE(counts.values == 1u);
+    REQUIRE(counts.errors == 1u);
+    REQUIRE(*values[0] == 1);
+    REQUIRE(*errors[0] == 2);
+}
+
+TEST_CASE("partition_results_indexed preserves positions", "[expected][extended][algorithms][partition_results]") {
+    std::vector<vien::expected<int, std::string>> v{1, vien::unexpected(std::string("a")), 2};
+
+    std::vector<std::pair<std::size_t, int>> values;
+    std::vector<std::pair<std::size_t, std::string>> errors;
+    auto counts = vien::partition_results_indexed(v, values, errors);
+
+    REQUIRE(counts.values == 2u);
+    REQUIRE(counts.errors == 1u);
+    REQUIRE(values == std::vector<std::pair<std::size_t, int>>{{0u, 1}, {2u, 2}});
+    REQUIRE(errors == std::vector<std::pair<std::size_t, std::string>>{{1u, "a"}});
+}
+
+TEST_CASE("accumulating stores errors inline up to N", "[expected][extended][algorithms][accumulating]") {
+    vien::accumulating<std::string, 2> errors;
+
+    auto is_inline = [](auto const& acc) {
+        auto const* p = reinterpret_cast<unsigned char const*>(acc.data());
+        auto const* first = reinterpret_cast<unsigned char const*>(&acc);
+        return p >= first && p < first + sizeof(acc);
+    };
+
+    REQUIRE(errors.empty());
+    errors.push_back("a");
+    errors.emplace_back(1u, 'b');
+    REQUIRE(errors.size() == 2u);
+    REQUIRE(is_inline(errors));
+
+    auto copy = errors;
+    REQUIRE(copy == errors);
+    REQUIRE(is_inline(copy));
+
+    errors.push_back(errors[0]);
+    REQUIRE(errors.size() == 3u);
+    REQUIRE(!is_inline(errors));
+    REQUIRE(std::vector<std::string>(std::begin(errors), std::end(errors)) ==
+            std::vector<std::string>{"a", "b", "a"});
+
+    auto moved = std::move(errors);
+    REQUIRE(moved.size() == 3u);
+    REQUIRE(errors.empty());
+
+    moved = copy;
+    REQUIRE(moved == copy);
+    REQUIRE(is_inline(moved));
+
+    moved.clear();
+    REQUIRE(moved.empty());
+}
+
+TEST_CASE("validate_all combines values or accumulates errors", "[expected][extended][algorithms][validate_all]") {
+    vien::expected<int, std::string> e1(1);
+    vien::expected<std::string, std::string> e2("two");
+    vien::expected<double, std::string> e3(vien::unexpected(std::string("three")));
+    vien::expected<int, std::string> e4(vien::unexpected(std::string("four")));
+
+    auto r1 = vien::validate_all(e1, e2);
+
+    REQUIRE(std::is_same_v<decltype(r1),
+                           vien::expected<std::tuple<int, std::string>, vien::accumulating<std::string, 4>>>);
+    REQUIRE(r1 == std::make_tuple(1, std::string("two")));
+
+    auto r2 = vien::validate_all<2>(e1, e3, std::move(e2), e4);
+
+    REQUIRE(!bool(r2));
+    REQUIRE(r2.error().size() == 2u);
+    REQUIRE(r2.error()[0] == "three");
+    REQUIRE(r2.error()[1] == "four");
+}
+
+TEST_CASE("zip_validate runs every check", "[expected][extended][algorithms][zip_validate]") {
+    auto non_empty = [](std::string const& str) -> vien::expected<void, std::string> {
+        if(str.empty())
+            return vien::unexpected(std::string("empty"));
+        return {};
+    };
+    auto short_enough = [](std::string const& str) -> vien::expected<void, std::string> {
+        if(str.size() > 3u)
+            return vien::unexpected(std::string("too long"));
+        return {};
+    };
+    auto lower = [](std::string const& str) -> vien::expected<int, std::string> {
+        if(str != "abc")
+            return vien::unexpected(std::string("not abc"));
+        return 0;
+    };
+
+    auto r1 = vien::zip_validate(std::string("abc"), non_empty, short_enough, lower);
+
+    REQUIRE(std::is_same_v<decltype(r1), vien::expected<std::string, vien::accumulating<std::string, 4>>>);
+    REQUIRE(r1 == "abc");
+
+    auto r2 = vien::zip_validate(std::string("abcd"), non_empty, short_enough, lower);
+
+    REQUIRE(!bool(r2));
+    REQUIRE(r2.error().size() == 2u);
+    REQUIRE(r2.error()[0] == "too long");
+    REQUIRE(r2.error()[1] == "not abc");
+}
+
+TEST_CASE("zip combines values into tuple", "[expected][extended][algorithms][zip]") {
+    vien::expected<int, std::string> e1(1);
+    vien::expected<std::unique_ptr<int>, std::string> e2(std::make_unique<int>(2));
+    vien::expected<double, std::string> e3(vien::unexpected(std::string("three")));
+    vien::expected<int, std::string> e4(vien::unexpected(std::string("four")));
+
+    auto r1 = vien::zip(e1, std::move(e2));
+
+    REQUIRE(std::is_same_v<decltype(r1), vien::expected<std::tuple<int, std::unique_ptr<int>>, std::string>>);
+    REQUIRE(bool(r1));
+    REQUIRE(std::get<0>(*r1) == 1);
+    REQUIRE(*std::get<1>(*r1) == 2);
+
+    auto r2 = vien::zip(e1, e4, e3);
+
+    REQUIRE(r2 == vien::unexpected(std::string("four")));
+}
+
+TEST_CASE("apply invokes callable with values", "[expected][extended][algorithms][apply]") {
+    vien::expected<int, std::string> e1(1);
+    vien::expected<std::string, std::string> e2("two");
+    vien::expected<int, std::string> e3(vien::unexpected(std::string("three")));
+
+    auto r1 = vien::apply([](int i, std::string str) {
+        return std::to_string(i) + str;
+    }, e1, std::move(e2));
+
+    REQUIRE(std::is_same_v<decltype(r1), vien::expected<std::string, std::string>>);
+    REQUIRE(r1 == "1two");
+
+    int invocations = 0;
+    auto r2 = vien::apply([&invocations](int, int) {
+        ++invocations;
+    }, e1, e3);
+
+    REQUIRE(std::is_same_v<decltype(r2), vien::expected<void, std::string>>);
+    REQUIRE(r2 == vien::unexpected(std::string("three")));
+    REQUIRE(invocations == 0);
+
+    auto r3 = vien::apply([&invocations](int) {
+        ++invocations;
+    }, e1);
+
+    REQUIRE(bool(r3));
+    REQUIRE(invocations == 1);
+}
+
+TEST_CASE("try_transform_reduce reduces transformed values", "[expected][extended][algorithms][try_transform_reduce]") {
+    std::vector<std::string> v{"1", "2", "3"};
+    auto parse = [](std::string const& s) -> vien::expected<int, std::string> {
+        if(s.empty() || s[0] < '0' || s[0] > '9')
+            return vien::unexpected("bad: " + s);
+        return s[0] - '0';
+    };
+
+    auto e1 = vien::try_transform_reduce(v, 10, std::plus<>{}, parse);
+
+    REQUIRE(std::is_same_v<decltype(e1), vien::expected<int, std::string>>);
+    REQUIRE(e1 == 16);
+
+    v.insert(std::begin(v) + 1, {"x", "y"});
+    int invocations = 0;
+    auto e2 = vien::try_transform_reduce(v, 0, std::plus<>{}, [&](std::string const& s) {
+        ++invocations;
+        return parse(s);
+    });
+
+    REQUIRE(e2 == vien::unexpected(std::string("bad: x")));
+    REQUIRE(invocations == 2);
+}
+
+#endif
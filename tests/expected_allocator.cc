@@ -0,0 +1,245 @@
+#ifndef EXPECTED_MANUAL_TEST
+#define VIEN_EXPECTED_EXTENDED
+#include "catch.hpp"
+#include "expected.h"
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <memory_resource>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using vien::unexpect;
+
+namespace {
+/* Long enough to defeat the small string optimization */
+char const* const long_str = "a string well beyond the small string buffer";
+
+/* Type taking its allocator as trailing argument */
+struct trailing_alloc_t {
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+    trailing_alloc_t(int j, allocator_type a) : i{j}, alloc{a} { }
+    trailing_alloc_t(trailing_alloc_t const& other, allocator_type a) : i{other.i}, alloc{a} { }
+
+    int i;
+    allocator_type alloc;
+};
+
+/* Type taking its allocator following std::allocator_arg */
+struct leading_alloc_t {
+    using allocator_type = std::pmr::polymorphic_allocator<char>;
+
+    leading_alloc_t(std::allocator_arg_t, allocator_type a, int j = 0) : i{j}, alloc{a} { }
+    leading_alloc_t(std::allocator_arg_t, allocator_type a, leading_alloc_t const& other)
+        : i{other.i}, alloc{a} { }
+    leading_alloc_t(std::allocator_arg_t, allocator_type a, leading_alloc_t&& other)
+        : i{other.i}, alloc{a} { }
+
+    int i;
+    allocator_type alloc;
+};
+
+/* Allocator throwing std::bad_alloc for requests of more than
+ * 64 bytes */
+template <typename T>
+struct limited_allocator_t {
+    using value_type = T;
+    static constexpr std::size_t limit = 64u;
+
+    limited_allocator_t() = default;
+    template <typename U>
+    limited_allocator_t(limited_allocator_t<U> const&) noexcept { }
+
+    T* allocate(std::size_t n) {
+        if(n * sizeof(T) > limit)
+            throw std::bad_alloc();
+        return std::allocator<T>{}.allocate(n);
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept {
+        std::allocator<T>{}.deallocate(p, n);
+    }
+
+    template <typename U>
+    bool operator==(limited_allocator_t<U> const&) const noexcept {
+        return true;
+    }
+
+    template <typename U>
+    bool operator!=(limited_allocator_t<U> const&) const noexcept {
+        return false;
+    }
+};
+
+struct throws_bad_alloc_t {
+    throws_bad_alloc_t() {
+        throw std::bad_alloc();
+    }
+};
+
+/* Error type constructible from alloc_error */
+struct app_error_t {
+    app_error_t(vien::alloc_error e) : bytes{e.bytes} { }
+
+    std::size_t bytes;
+};
+}
+
+TEST_CASE("uses_allocator is specialized for expected", "[expected][extended][allocator]") {
+    using pmr_alloc_t = std::pmr::polymorphic_allocator<char>;
+
+    REQUIRE(std::uses_allocator_v<vien::expected<std::pmr::string, int>, pmr_alloc_t>);
+    REQUIRE(std::uses_allocator_v<vien::expected<int, std::pmr::string>, pmr_alloc_t>);
+    REQUIRE(std::uses_allocator_v<vien::expected<void, std::pmr::string>, pmr_alloc_t>);
+    REQUIRE(!std::uses_allocator_v<vien::expected<int, int>, pmr_alloc_t>);
+}
+
+TEST_CASE("Allocator-extended ctors pass allocator to value", "[expected][extended][allocator]") {
+    std::pmr::monotonic_buffer_resource arena;
+    std::pmr::polymorphic_allocator<char> alloc(&arena);
+
+    vien::expected<std::pmr::string, int> e1(std::allocator_arg, alloc);
+    REQUIRE(bool(e1));
+    REQUIRE(e1->get_allocator().resource() == &arena);
+
+    vien::expected<std::pmr::string, int> e2(std::allocator_arg, alloc, long_str);
+    REQUIRE(e2 == long_str);
+    REQUIRE(e2->get_allocator().resource() == &arena);
+
+    vien::expected<std::pmr::string, int> e3(std::allocator_arg, alloc, std::in_place, 3u, 'c');
+    REQUIRE(e3 == "ccc");
+    REQUIRE(e3->get_allocator().resource() == &arena);
+
+    vien::expected<std::pmr::string, int> e4(std::pmr::string{long_str});
+    vien::expected<std::pmr::string, int> e5(std::allocator_arg, alloc, e4);
+    REQUIRE(e5 == long_str);
+    REQUIRE(e5->get_allocator().resource() == &arena);
+
+    vien::expected<std::pmr::string, int> e6(std::allocator_arg, alloc, std::move(e4));
+    REQUIRE(e6 == long_str);
+    REQUIRE(e6->get_allocator().resource() == &arena);
+
+    vien::expected<trailing_alloc_t, int> e7(std::allocator_arg, alloc, 10);
+    REQUIRE(e7->i == 10);
+    REQUIRE(e7->alloc.resource() == &arena);
+
+    vien::expected<leading_alloc_t, int> e8(std::allocator_arg, alloc, 20);
+    REQUIRE(e8->i == 20);
+    REQUIRE(e8->alloc.resource() == &arena);
+}
+
+TEST_CASE("Allocator-extended ctors pass allocator to error", "[expected][extended][allocator]") {
+    std::pmr::monotonic_buffer_resource arena;
+    std::pmr::polymorphic_allocator<char> alloc(&arena);
+
+    vien::expected<int, std::pmr::string> e1(std::allocator_arg, alloc, unexpect, long_str);
+    REQUIRE(!bool(e1));
+    REQUIRE(e1.error() == long_str);
+    REQUIRE(e1.error().get_allocator().resource() == &arena);
+
+    vien::unexpected<std::pmr::string> u(long_str);
+    vien::expected<int, std::pmr::string> e2(std::allocator_arg, alloc, u);
+    REQUIRE(e2.error().get_allocator().resource() == &arena);
+
+    vien::expected<int, std::pmr::string> e3(std::allocator_arg, alloc, std::move(u));
+    REQUIRE(e3.error() == long_str);
+    REQUIRE(e3.error().get_allocator().resource() == &arena);
+
+    vien::expected<int, std::pmr::string> e4(std::allocator_arg, alloc, e1);
+    REQUIRE(e4.error().get_allocator().resource() == &arena);
+
+    vien::expected<void, std::pmr::string> e5(std::allocator_arg, alloc, unexpect, long_str);
+    REQUIRE(e5.error().get_allocator().resource() == &arena);
+
+    vien::expected<void, std::pmr::string> e6(std::allocator_arg, alloc);
+    REQUIRE(bool(e6));
+
+    vien::expected<void, std::pmr::string> e7(std::allocator_arg, alloc, std::move(e5));
+    REQUIRE(e7.error() == long_str);
+    REQUIRE(e7.error().get_allocator().resource() == &arena);
+}
+
+TEST_CASE("pmr containers propagate memory resource to expected", "[expected][extended][allocator]") {
+    std::pmr::monotonic_buffer_resource arena;
+    std::pmr::vector<vien::expected<std::pmr::string, std::pmr::string>> v(&arena);
+
+    v.emplace_back(long_str);
+    v.emplace_back(vien::unexpected(std::pmr::string(long_str)));
+    v.push_back(v.front());
+
+    REQUIRE(v[0]->get_allocator().resource() == &arena);
+    REQUIRE(v[1].error().get_allocator().resource() == &arena);
+    REQUIRE(v[2]->get_allocator().resource() == &arena);
+    REQUIRE(v[2] == long_str);
+}
+
+TEST_CASE("try_make_unique reports allocation failure", "[expected][extended][fallible_allocation]") {
+    auto e1 = vien::try_make_unique<std::string>(long_str);
+
+    REQUIRE(std::is_same_v<decltype(e1), vien::expected<std::unique_ptr<std::string>, vien::alloc_error>>);
+    REQUIRE(bool(e1));
+    REQUIRE(**e1 == long_str);
+
+    auto e2 = vien::try_make_unique<throws_bad_alloc_t>();
+
+    REQUIRE(e2 == vien::unexpected(vien::alloc_error{sizeof(throws_bad_alloc_t)}));
+}
+
+TEST_CASE("try_allocate reports allocation failure", "[expected][extended][fallible_allocation]") {
+    limited_allocator_t<int> alloc;
+
+    auto e1 = vien::try_allocate(alloc, 4u);
+    REQUIRE(bool(e1));
+    alloc.deallocate(*e1, 4u);
+
+    auto e2 = vien::try_allocate(alloc, 32u);
+    REQUIRE(e2 == vien::unexpected(vien::alloc_error{32u * sizeof(int)}));
+}
+
+TEST_CASE("try_reserve reports allocation failure", "[expected][extended][fallible_allocation]") {
+    std::vector<int, limited_allocator_t<int>> v;
+
+    REQUIRE(bool(vien::try_reserve(v, 8u)));
+    REQUIRE(v.capacity() >= 8u);
+
+    auto e1 = vien::try_reserve(v, 32u);
+    REQUIRE(e1 == vien::unexpected(vien::alloc_error{32u * sizeof(int)}));
+
+    std::vector<int> v2;
+    REQUIRE(!vien::try_reserve(v2, v2.max_size() + 1u));
+}
+
+TEST_CASE("try_map_range reports allocation failure as error", "[expected][extended][fallible_allocation]") {
+    using vector_t = std::vector<int, limited_allocator_t<int>>;
+
+    vien::expected<vector_t, vien::alloc_error> e1(vector_t{1, 2, 3});
+    auto e2 = e1.try_map_range([](int i) { return 2.0 * i; });
+
+    REQUIRE(std::is_same_v<decltype(e2),
+                           vien::expected<std::vector<double, limited_allocator_t<double>>, vien::alloc_error>>);
+    REQUIRE(bool(e2));
+    REQUIRE((*e2)[2] == 6.0);
+
+    /* Source fits within the limit, the result does not */
+    vien::expected<std::vector<char, limited_allocator_t<char>>, app_error_t> e3(
+        std::vector<char, limited_allocator_t<char>>(16u, 'a'));
+    auto e4 = e3.try_map_range([](char c) { return 2.0 * c; });
+
+    REQUIRE(!bool(e4));
+    REQUIRE(e4.error().bytes == 16u * sizeof(double));
+
+    vien::expected<std::vector<int>, vien::alloc_error> e5(std::vector<int>{1, 2});
+    auto e6 = std::move(e5).try_map_range([](int) -> int { throw std::bad_alloc(); });
+
+    REQUIRE(e6 == vien::unexpected(vien::alloc_error{0u}));
+
+    vien::expected<std::vector<int>, app_error_t> e7(unexpect, vien::alloc_error{5u});
+    auto e8 = e7.try_map_range([](int i) { return i; });
+
+    REQUIRE(e8.error().bytes == 5u);
+}
+
+#endif
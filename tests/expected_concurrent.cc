@@ -0,0 +1,1086 @@
+#ifndef EXPECTED_MANUAL_TEST
+#include "catch.hpp"
+#include "expected_concurrent.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <future>
+#include <iterator>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+using vien::unexpect;
+
+namespace {
+
+/* Executor deferring tasks until run is called */
+struct queue_executor_t {
+    std::vector<vien::unique_task>* tasks;
+
+    void execute(vien::unique_task task) const {
+        tasks->push_back(std::move(task));
+    }
+
+    static void run(std::vector<vien::unique_task>& tasks) {
+        while(!tasks.empty()) {
+            auto task = std::move(tasks.front());
+            tasks.erase(tasks.begin());
+            task();
+        }
+    }
+};
+
+}
+
+TEST_CASE("expected_future is settled through expected_promise", "[concurrent][future]") {
+    vien::expected_promise<int, std::string> p;
+    auto f = p.get_future();
+
+    REQUIRE(f.valid());
+    REQUIRE(!f.is_ready());
+
+    p.set_value(3);
+
+    REQUIRE(f.is_ready());
+    REQUIRE(f.get() == 3);
+    REQUIRE(!f.valid());
+
+    vien::expected_promise<int, std::string> p2;
+    auto f2 = p2.get_future();
+    p2.set_error("err");
+
+    REQUIRE(f2.get() == vien::unexpected(std::string("err")));
+
+    REQUIRE_THROWS_AS(p2.get_future(), std::future_error);
+    REQUIRE_THROWS_AS(p2.set_value(1), std::future_error);
+}
+
+TEST_CASE("expected_future blocks until set on another thread", "[concurrent][future]") {
+    vien::expected_promise<std::unique_ptr<int>, int> p;
+    auto f = p.get_future();
+
+    std::thread t{[p = std::move(p)]() mutable {
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        p.set_value(std::make_unique<int>(5));
+    }};
+
+    auto r = f.get();
+    t.join();
+
+    REQUIRE(r);
+    REQUIRE(**r == 5);
+}
+
+TEST_CASE("expected_future continuations mirror expected", "[concurrent][future]") {
+    vien::expected_promise<int, int> p;
+    auto f = p.get_future()
+        .map([](int i) { return std::to_string(i); })
+        .and_then([](std::string s) { return s + "!"; })
+        .map_error([](int i) { return i * 2.0; });
+
+    REQUIRE(std::is_same_v<decltype(f), vien::expected_future<std::string, double>>);
+    REQUIRE(!f.is_ready());
+
+    p.set_value(4);
+
+    REQUIRE(f.get() == std::string("4!"));
+
+    vien::expected_promise<int, int> p2;
+    p2.set_error(4);
+    auto f2 = p2.get_future()
+        .map([](int i) { return i + 1; })
+        .map_error([](int i) { return std::to_string(i); });
+
+    REQUIRE(f2.get() == vien::unexpected(std::string("4")));
+}
+
+TEST_CASE("expected_future continuations run on executor", "[concurrent][future]") {
+    std::vector<vien::unique_task> tasks;
+    queue_executor_t ex{&tasks};
+
+    vien::expected_promise<int, int> p;
+    auto f = p.get_future()
+        .map(ex, [](int i) { return i + 1; })
+        .map(ex, [](int i) { return i * 2; });
+
+    p.set_value(1);
+
+    REQUIRE(tasks.size() == 1u);
+    REQUIRE(!f.is_ready());
+
+    queue_executor_t::run(tasks);
+
+    REQUIRE(f.get() == 4);
+}
+
+TEST_CASE("expected_future skips scheduling on short-circuit", "[concurrent][future]") {
+    std::vector<vien::unique_task> tasks;
+    queue_executor_t ex{&tasks};
+    int invocations = 0;
+
+    vien::expected_promise<int, int> p;
+    auto f = p.get_future()
+        .map(ex, [&invocations](int i) { ++invocations; return i; })
+        .and_then(ex, [&invocations](int i) { ++invocations; return i; })
+        .map_error(ex, [](int i) { return i + 1; });
+
+    p.set_error(1);
+
+    REQUIRE(tasks.size() == 1u);
+    queue_executor_t::run(tasks);
+
+    REQUIRE(f.get() == vien::unexpected(2));
+    REQUIRE(invocations == 0);
+
+    vien::expected_promise<int, int> p2;
+    auto f2 = p2.get_future().map_error(ex, [](int i) { return i; });
+    p2.set_value(2);
+
+    REQUIRE(tasks.empty());
+    REQUIRE(f2.get() == 2);
+}
+
+TEST_CASE("expected_future continuations attached after settling run immediately",
+          "[concurrent][future]") {
+    vien::expected_promise<void, int> p;
+    auto f = p.get_future();
+    p.set_value();
+
+    int calls = 0;
+    auto f2 = std::move(f).map([&calls]() { return ++calls; });
+
+    REQUIRE(calls == 1);
+    REQUIRE(f2.get() == 1);
+}
+
+TEST_CASE("expected_future propagates exceptions and broken promises", "[concurrent][future]") {
+    vien::expected_promise<int, int> p;
+    auto f = p.get_future().map([](int) -> int { throw std::runtime_error("thrown"); });
+    p.set_value(1);
+
+    REQUIRE_THROWS_AS(f.get(), std::runtime_error);
+
+    vien::expected_future<int, int> f2;
+    {
+        vien::expected_promise<int, int> p2;
+        f2 = p2.get_future().map([](int i) { return i; });
+    }
+
+    REQUIRE(f2.is_ready());
+    REQUIRE_THROWS_AS(f2.get(), std::future_error);
+}
+
+TEST_CASE("thread_pool runs submitted tasks", "[concurrent][thread_pool]") {
+    std::atomic<int> count{0};
+    {
+        vien::thread_pool pool{4};
+        REQUIRE(pool.concurrency() == 4u);
+
+        for(int i = 0; i < 1000; ++i)
+            pool.execute([&count] { ++count; });
+
+        /* Tasks submitted from workers go to their own deque */
+        pool.execute([&pool, &count] {
+            for(int i = 0; i < 100; ++i)
+                pool.execute([&count] { ++count; });
+        });
+    }
+
+    REQUIRE(count == 1100);
+}
+
+TEST_CASE("thread_pool executor drives expected_future continuations", "[concurrent][thread_pool]") {
+    vien::thread_pool pool{2};
+    vien::expected_promise<int, std::string> p;
+    auto f = p.get_future()
+        .map(pool.get_executor(), [](int i) { return i * 2; })
+        .map(pool.get_executor(), [](int i) { return std::to_string(i); });
+
+    p.set_value(21);
+
+    REQUIRE(f.get() == std::string("42"));
+}
+
+TEST_CASE("parallel_invoke_all collects results in order", "[concurrent][parallel_invoke_all]") {
+    vien::thread_pool pool{4};
+    std::vector<std::function<vien::expected<int, std::string>()>> tasks;
+    for(int i = 0; i < 10000; ++i) {
+        tasks.emplace_back([i]() -> vien::expected<int, std::string> {
+            if(i % 1000 == 999)
+                return vien::unexpected(std::to_string(i));
+            return i;
+        });
+    }
+
+    auto results = vien::parallel_invoke_all(pool, tasks);
+
+    REQUIRE(std::is_same_v<decltype(results), std::vector<vien::expected<int, std::string>>>);
+    REQUIRE(results.size() == tasks.size());
+    for(int i = 0; i < 10000; ++i) {
+        if(i % 1000 == 999)
+            REQUIRE(results[i] == vien::unexpected(std::to_string(i)));
+        else
+            REQUIRE(results[i] == i);
+    }
+
+    std::vector<std::function<vien::expected<int, std::string>()>> none;
+    REQUIRE(vien::parallel_invoke_all(pool, none).empty());
+    REQUIRE(vien::parallel_invoke_all(vien::inline_executor{}, tasks) == results);
+}
+
+TEST_CASE("parallel_invoke_all cancels remaining tasks on error", "[concurrent][parallel_invoke_all]") {
+    vien::thread_pool pool{4};
+    std::atomic<int> invocations{0};
+    std::vector<std::function<vien::expected<int, int>()>> tasks;
+    for(int i = 0; i < 10000; ++i) {
+        tasks.emplace_back([i, &invocations]() -> vien::expected<int, int> {
+            ++invocations;
+            if(i == 10)
+                return vien::unexpected(i);
+            return i;
+        });
+    }
+
+    auto results = vien::parallel_invoke_all(vien::inline_executor{}, tasks, vien::cancel_on_error);
+
+    REQUIRE(invocations == 11);
+    REQUIRE(results.size() == tasks.size());
+    REQUIRE(results[9] == 9);
+    REQUIRE(results[10] == vien::unexpected(10));
+    REQUIRE(results[9999] == vien::unexpected(10));
+
+    results = vien::parallel_invoke_all(pool, tasks, vien::cancel_on_error);
+
+    REQUIRE(results[10] == vien::unexpected(10));
+    for(auto const& r : results)
+        REQUIRE((r || r.error() == 10));
+}
+
+TEST_CASE("parallel_invoke_all rethrows exceptions", "[concurrent][parallel_invoke_all]") {
+    vien::thread_pool pool{2};
+    std::vector<std::function<vien::expected<int, int>()>> tasks(100, []() -> vien::expected<int, int> {
+        return 1;
+    });
+    tasks[50] = []() -> vien::expected<int, int> { throw std::runtime_error("thrown"); };
+
+    REQUIRE_THROWS_AS(vien::parallel_invoke_all(pool, tasks), std::runtime_error);
+}
+
+TEST_CASE("parallel_invoke_all may be nested", "[concurrent][parallel_invoke_all]") {
+    vien::thread_pool pool{2};
+    std::vector<std::function<vien::expected<int, int>()>> tasks(8, [&pool]() -> vien::expected<int, int> {
+        std::vector<std::function<vien::expected<int, int>()>> inner(8, []() -> vien::expected<int, int> {
+            return 1;
+        });
+        int sum = 0;
+        for(auto const& r : vien::parallel_invoke_all(pool, inner))
+            sum += *r;
+        return sum;
+    });
+
+    for(auto const& r : vien::parallel_invoke_all(pool, tasks))
+        REQUIRE(r == 8);
+}
+
+TEST_CASE("parallel try_transform_reduce matches sequential", "[concurrent][try_transform_reduce]") {
+    vien::thread_pool pool{4};
+    std::vector<int> v(100000);
+    std::iota(std::begin(v), std::end(v), 0);
+    auto transform = [](int i) -> vien::expected<long long, int> {
+        return static_cast<long long>(i) * 2;
+    };
+
+    auto e1 = vien::try_transform_reduce(pool, v, 5LL, std::plus<>{}, transform);
+    auto e2 = vien::try_transform_reduce(v, 5LL, std::plus<>{}, transform);
+
+    REQUIRE(std::is_same_v<decltype(e1), vien::expected<long long, int>>);
+    REQUIRE(e1 == e2);
+    REQUIRE(e1 == 5LL + 99999LL * 100000LL);
+
+    std::vector<int> empty;
+    REQUIRE(vien::try_transform_reduce(pool, empty, 5LL, std::plus<>{}, transform) == 5LL);
+}
+
+TEST_CASE("parallel try_transform_reduce returns first error by index", "[concurrent][try_transform_reduce]") {
+    vien::thread_pool pool{4};
+    std::vector<int> v(100000);
+    std::iota(std::begin(v), std::end(v), 0);
+    std::atomic<int> invocations{0};
+    auto transform = [&invocations](int i) -> vien::expected<int, int> {
+        ++invocations;
+        if(i % 7919 == 7918)
+            return vien::unexpected(i);
+        return i;
+    };
+
+    for(int i = 0; i < 10; ++i) {
+        invocations = 0;
+        auto e = vien::try_transform_reduce(pool, v, 0, std::plus<>{}, transform);
+
+        REQUIRE(e == vien::unexpected(7918));
+        REQUIRE(invocations >= 7919);
+    }
+
+    auto e = vien::try_transform_reduce(vien::inline_executor{}, v, 0, std::plus<>{}, transform);
+    REQUIRE(e == vien::unexpected(7918));
+}
+
+TEST_CASE("parallel try_transform_reduce rethrows exceptions", "[concurrent][try_transform_reduce]") {
+    vien::thread_pool pool{2};
+    std::vector<int> v(1000, 1);
+    v[500] = 0;
+    auto transform = [](int i) -> vien::expected<int, int> {
+        if(i == 0)
+            throw std::runtime_error("thrown");
+        return i;
+    };
+
+    REQUIRE_THROWS_AS(vien::try_transform_reduce(pool, v, 0, std::plus<>{}, transform), std::runtime_error);
+}
+
+namespace {
+
+/* Receiver recording the channel it was completed on */
+template <typename T, typename E>
+struct recording_receiver_t {
+    std::optional<T>* value;
+    std::optional<E>* error;
+
+    template <typename U>
+    void set_value(U&& u) {
+        value->emplace(std::forward<U>(u));
+    }
+
+    template <typename G>
+    void set_error(G&& g) {
+        error->emplace(std::forward<G>(g));
+    }
+
+    void set_stopped() { }
+};
+
+}
+
+TEST_CASE("as_sender completes on value or error channel", "[concurrent][senders]") {
+    std::optional<int> value;
+    std::optional<std::string> error;
+
+    auto op1 = vien::as_sender(vien::expected<int, std::string>(1))
+        .connect(recording_receiver_t<int, std::string>{&value, &error});
+    op1.start();
+
+    REQUIRE(value == 1);
+    REQUIRE(!error);
+
+    value.reset();
+    auto op2 = vien::as_sender(vien::expected<int, std::string>(unexpect, "err"))
+        .connect(recording_receiver_t<int, std::string>{&value, &error});
+    op2.start();
+
+    REQUIRE(!value);
+    REQUIRE(error == std::string("err"));
+}
+
+TEST_CASE("then_expected unwraps into completion channels", "[concurrent][senders]") {
+    auto s = vien::then_expected(vien::as_sender(vien::expected<int, std::string>(2)),
+                                 [](int i) -> vien::expected<double, std::string> {
+                                     if(i < 0)
+                                         return vien::unexpected(std::string("negative"));
+                                     return i * 1.5;
+                                 });
+
+    REQUIRE(std::is_same_v<decltype(s)::value_type, double>);
+    REQUIRE(std::is_same_v<decltype(s)::error_type, std::string>);
+    REQUIRE(*vien::sync_wait_expected(std::move(s)) == vien::expected<double, std::string>(3.0));
+
+    auto failing = [](int) -> vien::expected<int, std::string> {
+        return vien::unexpected(std::string("failed"));
+    };
+    auto r1 = vien::sync_wait_expected(
+        vien::then_expected(vien::as_sender(vien::expected<int, std::string>(1)), failing));
+    REQUIRE(*r1 == vien::expected<int, std::string>(unexpect, "failed"));
+
+    int invocations = 0;
+    auto r2 = vien::sync_wait_expected(
+        vien::then_expected(vien::as_sender(vien::expected<int, char const*>(unexpect, "upstream")),
+                            [&invocations](int i) -> vien::expected<int, std::string> {
+                                ++invocations;
+                                return i;
+                            }));
+    REQUIRE(*r2 == vien::expected<int, std::string>(unexpect, "upstream"));
+    REQUIRE(invocations == 0);
+}
+
+TEST_CASE("let_expected chains senders", "[concurrent][senders]") {
+    auto s = vien::let_expected(vien::as_sender(vien::expected<std::string, int>("abc")),
+                                [](std::string const& str) {
+                                    return vien::as_sender(vien::expected<std::size_t, int>(str.size()));
+                                });
+
+    REQUIRE(*vien::sync_wait_expected(std::move(s)) == vien::expected<std::size_t, int>(3u));
+
+    auto r = vien::sync_wait_expected(
+        vien::let_expected(vien::as_sender(vien::expected<std::string, int>("abc")),
+                           [](std::string const&) {
+                               return vien::as_sender(vien::expected<std::size_t, int>(unexpect, 4));
+                           }));
+    REQUIRE(*r == vien::expected<std::size_t, int>(unexpect, 4));
+}
+
+TEST_CASE("into_expected sends completion in value channel", "[concurrent][senders]") {
+    auto s = vien::into_expected(vien::as_sender(vien::expected<int, std::string>(unexpect, "err")));
+
+    REQUIRE(std::is_same_v<decltype(s)::value_type, vien::expected<int, std::string>>);
+
+    std::optional<vien::expected<int, std::string>> value;
+    std::optional<int> error;
+    auto op = std::move(s).connect(recording_receiver_t<vien::expected<int, std::string>, int>{&value, &error});
+    op.start();
+
+    REQUIRE(*value == vien::expected<int, std::string>(unexpect, "err"));
+}
+
+TEST_CASE("senders run on run_loop", "[concurrent][senders]") {
+    vien::run_loop loop;
+    std::thread worker{[&loop] { loop.run(); }};
+    auto sched = loop.get_scheduler();
+
+    std::thread::id id;
+    std::thread::id const worker_id = worker.get_id();
+    auto s = vien::then_expected(sched.schedule(), [&id]() -> vien::expected<int, std::string> {
+        id = std::this_thread::get_id();
+        return 7;
+    });
+    auto s2 = vien::let_expected(std::move(s), [sched](int i) {
+        return vien::then_expected(sched.schedule(), [i]() -> vien::expected<int, std::string> {
+            return i * 2;
+        });
+    });
+
+    auto r = vien::sync_wait_expected(std::move(s2));
+
+    loop.finish();
+    worker.join();
+
+    REQUIRE(*r == vien::expected<int, std::string>(14));
+    REQUIRE(id == worker_id);
+}
+
+TEST_CASE("atomic_expected is set once", "[concurrent][atomic_expected]") {
+    vien::atomic_expected<std::string, int> slot;
+
+    REQUIRE(!slot.is_ready());
+    REQUIRE(slot.try_get() == nullptr);
+
+    REQUIRE(slot.set_value("abc"));
+    REQUIRE(!slot.set_value("def"));
+    REQUIRE(!slot.set_error(1));
+
+    REQUIRE(slot.is_ready());
+    REQUIRE(slot.get() == std::string("abc"));
+    REQUIRE(slot.try_get() == &slot.get());
+
+    vien::atomic_expected<void, int> v;
+    REQUIRE(v.set_error(2));
+    REQUIRE(v.get() == vien::unexpected(2));
+
+    vien::atomic_expected<int, int> r;
+    REQUIRE(r.set_result(vien::expected<int, int>(3)));
+    REQUIRE(r.get() == 3);
+}
+
+TEST_CASE("atomic_expected may be set again after a throwing set", "[concurrent][atomic_expected]") {
+    struct throwing_t {
+        explicit throwing_t(bool do_throw) {
+            if(do_throw)
+                throw std::runtime_error("thrown");
+        }
+    };
+
+    vien::atomic_expected<throwing_t, int> slot;
+
+    REQUIRE_THROWS_AS(slot.set_value(true), std::runtime_error);
+    REQUIRE(!slot.is_ready());
+    REQUIRE(slot.set_value(false));
+    REQUIRE(slot.is_ready());
+}
+
+TEST_CASE("atomic_expected hands off between threads", "[concurrent][atomic_expected]") {
+    vien::atomic_expected<std::vector<int>, std::string> slot;
+    std::atomic<int> sum{0};
+
+    std::vector<std::thread> readers;
+    for(int i = 0; i < 8; ++i) {
+        readers.emplace_back([&slot, &sum] {
+            auto const& e = slot.get();
+            for(int v : *e)
+                sum += v;
+        });
+    }
+
+    std::thread producer{[&slot] {
+        slot.set_value(std::vector<int>{1, 2, 3});
+    }};
+
+    producer.join();
+    for(auto& t : readers)
+        t.join();
+
+    REQUIRE(sum == 48);
+}
+
+TEST_CASE("packed_expected fits a single word", "[concurrent][packed_expected]") {
+    using packed_t = vien::packed_expected<std::uint32_t, std::uint16_t>;
+
+    REQUIRE(sizeof(packed_t) == sizeof(std::uint64_t));
+    REQUIRE(std::is_trivially_copyable_v<packed_t>);
+    REQUIRE(std::atomic<packed_t>::is_always_lock_free);
+
+    packed_t e1;
+    REQUIRE(e1.has_value());
+    REQUIRE(*e1 == 0u);
+
+    packed_t e2 = 0xffffffffu;
+    REQUIRE(e2);
+    REQUIRE(e2.value() == 0xffffffffu);
+
+    packed_t e3 = vien::unexpected(std::uint16_t{0xffff});
+    REQUIRE(!e3);
+    REQUIRE(e3.error() == 0xffff);
+    REQUIRE_THROWS_AS(e3.value(), vien::bad_expected_access<std::uint16_t>);
+    REQUIRE(e3.value_or(7u) == 7u);
+
+    packed_t e4(unexpect, 3);
+    REQUIRE(e4.error() == 3);
+    REQUIRE(e4 != e3);
+    REQUIRE(e4 == packed_t(unexpect, 3));
+
+    vien::packed_expected<void, char> e5;
+    REQUIRE(e5);
+    REQUIRE(vien::packed_expected<void, char>(unexpect, 'a').error() == 'a');
+
+    struct point_t {
+        std::int16_t x;
+        std::int16_t y;
+    };
+    vien::packed_expected<point_t, char> e6(std::in_place, point_t{-1, 2});
+    REQUIRE((*e6).x == -1);
+    REQUIRE((*e6).y == 2);
+    REQUIRE(!vien::concurrent_detail::is_packable_v<std::array<char, 8>>);
+}
+
+TEST_CASE("packed_expected converts to and from expected", "[concurrent][packed_expected]") {
+    vien::expected<int, short> e1(4);
+    vien::packed_expected<int, short> p1 = e1;
+
+    REQUIRE(*p1 == 4);
+    REQUIRE(p1.to_expected() == e1);
+
+    vien::expected<int, short> e2(unexpect, short{2});
+    vien::packed_expected<int, short> p2 = e2;
+
+    REQUIRE(p2.error() == 2);
+    REQUIRE(p2.to_expected() == e2);
+
+    vien::expected<void, short> e3;
+    REQUIRE(vien::packed_expected<void, short>(e3).to_expected() == e3);
+}
+
+TEST_CASE("packed_expected monadic functions", "[concurrent][packed_expected]") {
+    vien::packed_expected<int, short> e1 = 2;
+
+    auto e2 = e1.map([](int i) { return static_cast<char>('a' + i); });
+    REQUIRE(std::is_same_v<decltype(e2), vien::packed_expected<char, short>>);
+    REQUIRE(*e2 == 'c');
+
+    auto e3 = e1.map_error([](short s) { return static_cast<int>(s) * 2; });
+    REQUIRE(std::is_same_v<decltype(e3), vien::packed_expected<int, int>>);
+    REQUIRE(*e3 == 2);
+
+    REQUIRE(*e1.and_then([](int i) { return i * i; }) == 4);
+    REQUIRE(*e1.or_else([](short s) { return s; }) == 2);
+
+    vien::packed_expected<int, short> e4(unexpect, short{5});
+    REQUIRE(e4.map([](int i) { return i + 1; }).error() == 5);
+    REQUIRE(e4.map_error([](short s) { return s + 1; }).error() == 6);
+    REQUIRE(e4.or_else([](short s) { return static_cast<short>(s * 2); }).error() == 10);
+
+    vien::packed_expected<void, short> e5;
+    REQUIRE(*e5.map([] { return 1; }) == 1);
+}
+
+TEST_CASE("packed_expected is updated atomically", "[concurrent][packed_expected]") {
+    using packed_t = vien::packed_expected<std::uint32_t, std::uint16_t>;
+    std::atomic<packed_t> cell{packed_t(0u)};
+
+    std::vector<std::thread> threads;
+    for(int i = 0; i < 4; ++i) {
+        threads.emplace_back([&cell] {
+            for(int j = 0; j < 1000; ++j) {
+                packed_t prev = cell.load();
+                while(!cell.compare_exchange_weak(prev, prev.map([](std::uint32_t v) { return v + 1u; })))
+                    ;
+            }
+        });
+    }
+    for(auto& t : threads)
+        t.join();
+
+    REQUIRE(*cell.load() == 4000u);
+
+    packed_t expected_value = 4000u;
+    REQUIRE(cell.compare_exchange_strong(expected_value, packed_t(unexpect, 1)));
+    REQUIRE(cell.load().error() == 1);
+}
+
+TEST_CASE("latest_expected returns latest published", "[concurrent][latest_expected]") {
+    vien::latest_expected<std::string, int> slot;
+
+    REQUIRE(slot.read() == std::string{});
+
+    slot.publish(std::string("abc"));
+    REQUIRE(slot.read() == std::string("abc"));
+    REQUIRE(slot.has_value());
+
+    slot.publish(vien::unexpected(3));
+    REQUIRE(slot.read() == vien::unexpected(3));
+    REQUIRE(!slot.has_value());
+    REQUIRE(slot.visit([](auto const& e) { return e.error(); }) == 3);
+
+    vien::latest_expected<void, int> status(vien::unexpected(1));
+    REQUIRE(!status.has_value());
+    status.publish({});
+    REQUIRE(status.read());
+}
+
+TEST_CASE("latest_expected readers never observe partial writes", "[concurrent][latest_expected]") {
+    using snapshot_t = std::vector<int>;
+    vien::latest_expected<snapshot_t, std::string> slot(snapshot_t(1, 0));
+    std::atomic<bool> done{false};
+    std::atomic<int> inconsistent{0};
+
+    std::vector<std::thread> readers;
+    for(int i = 0; i < 4; ++i) {
+        readers.emplace_back([&] {
+            while(!done.load()) {
+                auto e = slot.read();
+                if(e) {
+                    for(int v : *e)
+                        inconsistent += v != static_cast<int>(e->size()) - 1;
+                }
+                else {
+                    inconsistent += e.error() != "error";
+                }
+            }
+        });
+    }
+
+    for(int i = 1; i < 2000; ++i) {
+        if(i % 7 == 0)
+            slot.publish(vien::unexpected(std::string("error")));
+        else
+            slot.publish(snapshot_t(i % 50 + 1, i % 50));
+    }
+    done = true;
+    for(auto& t : readers)
+        t.join();
+
+    REQUIRE(inconsistent == 0);
+    REQUIRE(slot.read() == snapshot_t(1999 % 50 + 1, 1999 % 50));
+}
+
+TEST_CASE("lazy_expected computes once", "[concurrent][lazy_expected]") {
+    std::atomic<int> calls{0};
+    vien::lazy_expected lazy([&calls]() -> vien::expected<std::string, int> {
+        ++calls;
+        return std::string("value");
+    });
+
+    REQUIRE(std::is_same_v<decltype(lazy)::value_type, std::string>);
+    REQUIRE(std::is_same_v<decltype(lazy)::error_type, int>);
+    REQUIRE(!lazy.is_ready());
+
+    std::vector<std::thread> threads;
+    std::atomic<int> mismatches{0};
+    std::atomic<std::string const*> address{nullptr};
+    for(int i = 0; i < 8; ++i) {
+        threads.emplace_back([&] {
+            auto e = lazy.get();
+            mismatches += !e || e->get() != "value";
+            std::string const* expected_address = nullptr;
+            if(!address.compare_exchange_strong(expected_address, &e->get()))
+                mismatches += expected_address != &e->get();
+        });
+    }
+    for(auto& t : threads)
+        t.join();
+
+    REQUIRE(calls == 1);
+    REQUIRE(mismatches == 0);
+    REQUIRE(lazy.is_ready());
+}
+
+TEST_CASE("lazy_expected caches errors by default", "[concurrent][lazy_expected]") {
+    int calls = 0;
+    vien::lazy_expected<int, std::string> lazy([&calls]() -> vien::expected<int, std::string> {
+        ++calls;
+        return vien::unexpected(std::string("failed"));
+    });
+
+    REQUIRE(lazy.get().error() == "failed");
+    REQUIRE(lazy.get().error() == "failed");
+    REQUIRE(calls == 1);
+    REQUIRE(lazy.is_ready());
+}
+
+TEST_CASE("lazy_expected retries transient errors", "[concurrent][lazy_expected]") {
+    int calls = 0;
+    vien::lazy_expected lazy([&calls]() -> vien::expected<int, int> {
+        ++calls;
+        if(calls < 3)
+            return vien::unexpected(calls);
+        return 42;
+    }, [](int) { return true; });
+
+    REQUIRE(lazy.get().error() == 1);
+    REQUIRE(!lazy.is_ready());
+    REQUIRE(lazy.get().error() == 2);
+    REQUIRE(lazy.get() == 42);
+    REQUIRE(lazy.get() == 42);
+    REQUIRE(calls == 3);
+}
+
+TEST_CASE("lazy_expected shares transient errors with waiting callers", "[concurrent][lazy_expected]") {
+    constexpr int threads = 8;
+    std::atomic<int> arrived{0};
+    std::atomic<int> calls{0};
+    vien::lazy_expected lazy([&]() -> vien::expected<int, int> {
+        if(++calls == 1) {
+            while(arrived.load() < threads)
+                std::this_thread::yield();
+            std::this_thread::sleep_for(std::chrono::milliseconds(50));
+            return vien::unexpected(-1);
+        }
+        return 1;
+    }, [](int) { return true; });
+
+    std::atomic<int> failed{0};
+    std::vector<std::thread> workers;
+    for(int i = 0; i < threads; ++i) {
+        workers.emplace_back([&] {
+            ++arrived;
+            failed += lazy.get() == vien::unexpected(-1);
+        });
+    }
+    for(auto& t : workers)
+        t.join();
+
+    REQUIRE(calls == 1);
+    REQUIRE(failed == threads);
+    REQUIRE(lazy.get() == 1);
+    REQUIRE(calls == 2);
+}
+
+TEST_CASE("lazy_expected retries after exceptions", "[concurrent][lazy_expected]") {
+    int calls = 0;
+    vien::lazy_expected<void, int> lazy([&calls]() -> vien::expected<void, int> {
+        if(++calls == 1)
+            throw std::runtime_error("thrown");
+        return {};
+    });
+
+    REQUIRE_THROWS_AS(lazy.get(), std::runtime_error);
+    REQUIRE(!lazy.is_ready());
+    REQUIRE(lazy.get());
+    REQUIRE(calls == 2);
+}
+
+TEST_CASE("shared_expected shares a single expected", "[concurrent][shared_expected]") {
+    vien::expected<std::vector<char>, std::string> blob{std::vector<char>(1024, 'x')};
+    char const* data = blob->data();
+
+    vien::shared_expected<std::vector<char>, std::string> a = std::move(blob);
+    REQUIRE(a.use_count() == 1u);
+    REQUIRE(a->data() == data);
+
+    auto b = a;
+    REQUIRE(a.use_count() == 2u);
+    REQUIRE(&*b == &*a);
+    REQUIRE(b.value().size() == 1024u);
+
+    auto c = std::move(b);
+    REQUIRE(a.use_count() == 2u);
+    b = c;
+    REQUIRE(a.use_count() == 3u);
+    c = vien::shared_expected<std::vector<char>, std::string>(unexpect, "other");
+    REQUIRE(a.use_count() == 2u);
+    REQUIRE(c.error() == "other");
+}
+
+TEST_CASE("shared_expected monadic functions", "[concurrent][shared_expected]") {
+    vien::shared_expected<int, std::string> v(std::in_place, 3);
+    vien::shared_expected<int, std::string> e(unexpect, "error");
+
+    REQUIRE(v.map([](int x) { return x * 2; }) == 6);
+    REQUIRE(e.map([](int x) { return x * 2; }).error() == "error");
+    REQUIRE(v.and_then([](int x) { return x + 1; }) == 4);
+    REQUIRE(e.or_else([](std::string const&) { return std::string("handled"); }).error() == "handled");
+    REQUIRE(e.map_error([](std::string const& s) { return s.size(); }).error() == 5u);
+    REQUIRE(v.value_or(0) == 3);
+    REQUIRE(e.value_or(0) == 0);
+    REQUIRE_THROWS_AS(e.value(), vien::bad_expected_access<std::string>);
+
+    vien::shared_expected<void, int> ok = vien::expected<void, int>{};
+    REQUIRE(ok);
+}
+
+TEST_CASE("shared_expected copies across threads", "[concurrent][shared_expected]") {
+    vien::shared_expected<std::string, int> shared(std::in_place, "payload");
+    std::atomic<int> mismatches{0};
+
+    std::vector<std::thread> threads;
+    for(int i = 0; i < 4; ++i) {
+        threads.emplace_back([shared, &mismatches] {
+            for(int j = 0; j < 1000; ++j) {
+                auto copy = shared;
+                mismatches += *copy != "payload";
+            }
+        });
+    }
+    for(auto& t : threads)
+        t.join();
+
+    REQUIRE(mismatches == 0);
+    REQUIRE(shared.use_count() == 1u);
+}
+
+TEST_CASE("expected_channel is a bounded fifo", "[concurrent][expected_channel]") {
+    vien::expected_channel<int, std::string> ch(3);
+    REQUIRE(ch.capacity() == 4u);
+
+    REQUIRE(ch.try_push(1));
+    REQUIRE(ch.try_push(vien::expected<int, std::string>(unexpect, "item")));
+    REQUIRE(ch.try_push(3));
+    REQUIRE(ch.try_push(4));
+    REQUIRE(!ch.try_push(5));
+
+    REQUIRE(*ch.try_pop() == 1);
+    REQUIRE(ch.try_pop()->error() == "item");
+    REQUIRE(ch.try_push(5));
+
+    std::vector<vien::expected<int, std::string>> out;
+    REQUIRE(ch.try_pop_batch(std::back_inserter(out), 2u) == 2u);
+    REQUIRE(ch.try_pop_batch(std::back_inserter(out), 8u) == 1u);
+    REQUIRE(ch.try_pop_batch(std::back_inserter(out), 8u) == 0u);
+    REQUIRE(out == std::vector<vien::expected<int, std::string>>{3, 4, 5});
+    REQUIRE(!ch.try_pop());
+}
+
+TEST_CASE("expected_channel drains before reporting close", "[concurrent][expected_channel]") {
+    vien::expected_channel<std::unique_ptr<int>, int> ch(8);
+    REQUIRE(ch.try_push(std::make_unique<int>(1)));
+    REQUIRE(ch.try_push(std::make_unique<int>(2)));
+
+    REQUIRE(ch.close(7));
+    REQUIRE(!ch.close(8));
+    REQUIRE(ch.is_closed());
+    REQUIRE(!ch.try_push(std::make_unique<int>(3)));
+
+    REQUIRE(**ch.pop() == 1);
+    REQUIRE(***ch.try_pop() == 2);
+    REQUIRE(ch.pop().error() == 7);
+    REQUIRE(ch.try_pop()->error() == 7);
+
+    std::vector<vien::expected<std::unique_ptr<int>, int>> out;
+    REQUIRE(ch.try_pop_batch(std::back_inserter(out), 4u).error() == 7);
+
+    /* Elements left in the channel are destroyed with it */
+    vien::expected_channel<std::unique_ptr<int>, int> leftover(4);
+    REQUIRE(leftover.try_push(std::make_unique<int>(1)));
+}
+
+TEST_CASE("expected_channel close wakes blocked consumers", "[concurrent][expected_channel]") {
+    vien::expected_channel<int, std::string> ch(4);
+    std::atomic<int> woken{0};
+
+    std::vector<std::thread> consumers;
+    for(int i = 0; i < 4; ++i) {
+        consumers.emplace_back([&] {
+            woken += ch.pop().error() == "closed";
+        });
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    ch.close("closed");
+    for(auto& t : consumers)
+        t.join();
+
+    REQUIRE(woken == 4);
+}
+
+TEST_CASE("expected_channel delivers every push racing with close", "[concurrent][expected_channel]") {
+    for(int round = 0; round < 20; ++round) {
+        vien::expected_channel<int, int> ch(16);
+        std::atomic<int> pushed{0};
+        std::atomic<int> popped{0};
+
+        std::vector<std::thread> threads;
+        for(int i = 0; i < 3; ++i) {
+            threads.emplace_back([&] {
+                while(true) {
+                    if(ch.try_push(1))
+                        ++pushed;
+                    else if(ch.is_closed())
+                        return;
+                    else
+                        std::this_thread::yield();
+                }
+            });
+        }
+        for(int i = 0; i < 3; ++i) {
+            threads.emplace_back([&] {
+                while(ch.pop())
+                    ++popped;
+            });
+        }
+
+        std::this_thread::sleep_for(std::chrono::microseconds(200 * (round % 5)));
+        ch.close(-1);
+        for(auto& t : threads)
+            t.join();
+
+        REQUIRE(popped == pushed);
+        REQUIRE(ch.try_pop()->error() == -1);
+    }
+}
+
+TEST_CASE("expected_channel wakes all consumers once drained after close", "[concurrent][expected_channel]") {
+    /* Blocks in its move constructor until the gate is opened */
+    struct gate_t {
+        std::atomic<bool> entered{false};
+        std::atomic<bool> open{false};
+    };
+    struct gated_t {
+        gated_t() noexcept : gate{nullptr} { }
+        explicit gated_t(gate_t* g) noexcept : gate{g} { }
+        gated_t(gated_t&& other) noexcept : gate{other.gate} {
+            if(!gate)
+                return;
+            gate->entered = true;
+            while(!gate->open.load())
+                std::this_thread::yield();
+        }
+
+        gate_t* gate;
+    };
+
+    gate_t gate;
+    vien::expected_channel<gated_t, int> ch(4);
+    std::atomic<int> values{0};
+    std::atomic<int> errors{0};
+
+    std::vector<std::thread> consumers;
+    for(int i = 0; i < 3; ++i) {
+        consumers.emplace_back([&] {
+            auto e = ch.pop();
+            if(e)
+                ++values;
+            else
+                errors += e.error() == -1;
+        });
+    }
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+
+    /* Claims a cell, then blocks before publishing it */
+    std::thread producer([&] {
+        REQUIRE(ch.try_push(vien::expected<gated_t, int>(std::in_place, &gate)));
+    });
+    while(!gate.entered.load())
+        std::this_thread::yield();
+
+    ch.close(-1);
+    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    gate.open = true;
+
+    producer.join();
+    for(auto& t : consumers)
+        t.join();
+
+    REQUIRE(values == 1);
+    REQUIRE(errors == 2);
+}
+
+TEST_CASE("expected_channel with multiple producers and consumers", "[concurrent][expected_channel]") {
+    constexpr int producers = 4;
+    constexpr int per_producer = 5000;
+    vien::expected_channel<int, int> ch(64);
+    std::atomic<long long> sum{0};
+    std::atomic<int> errors{0};
+    std::atomic<int> received{0};
+
+    std::vector<std::thread> consumers;
+    for(int i = 0; i < 4; ++i) {
+        consumers.emplace_back([&, batched = i % 2 == 0] {
+            std::vector<vien::expected<int, int>> batch;
+            while(true) {
+                if(batched) {
+                    batch.clear();
+                    auto n = ch.try_pop_batch(std::back_inserter(batch), 16u);
+                    if(!n)
+                        return;
+                    if(*n == 0u)
+                        std::this_thread::yield();
+                }
+                else {
+                    auto e = ch.pop();
+                    if(!e && e.error() == -1)
+                        return;
+                    batch.assign(1u, std::move(e));
+                }
+                for(auto const& e : batch) {
+                    ++received;
+                    if(e)
+                        sum += *e;
+                    else
+                        ++errors;
+                }
+            }
+        });
+    }
+
+    std::vector<std::thread> threads;
+    for(int p = 0; p < producers; ++p) {
+        threads.emplace_back([&ch, p] {
+            for(int i = 1; i <= per_producer; ++i) {
+                vien::expected<int, int> e = i % 100 == 0 ? vien::expected<int, int>(unexpect, p)
+                                                           : vien::expected<int, int>(i);
+                while(!ch.try_push(std::move(e)))
+                    std::this_thread::yield();
+            }
+        });
+    }
+    for(auto& t : threads)
+        t.join();
+    ch.close(-1);
+    for(auto& t : consumers)
+        t.join();
+
+    long long expected_sum = 0;
+    for(int i = 1; i <= per_producer; ++i)
+        expected_sum += i % 100 == 0 ? 0 : i;
+
+    REQUIRE(received == producers * per_producer);
+    REQUIRE(errors == producers * (per_producer / 100));
+    REQUIRE(sum == producers * expected_sum);
+}
+
+#endif
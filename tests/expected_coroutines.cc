@@ -0,0 +1,198 @@
+#ifndef EXPECTED_MANUAL_TEST
+#define VIEN_EXPECTED_EXTENDED
+#include "catch.hpp"
+#include "expected.h"
+
+#ifdef VIEN_EXPECTED_COROUTINES
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <type_traits>
+#include <utility>
+
+using vien::unexpect;
+
+namespace {
+
+vien::expected<int, std::string> parse_digit(char c) {
+    if(c < '0' || c > '9')
+        return vien::unexpected(std::string("not a digit: ") + c);
+    return c - '0';
+}
+
+vien::expected<int, std::string> sum_digits(char a, char b) {
+    int x = co_await parse_digit(a);
+    int y = co_await parse_digit(b);
+    co_return x + y;
+}
+
+vien::expected<int, std::string> chain(int depth, bool fail) {
+    if(depth == 0) {
+        if(fail)
+            co_return vien::unexpected(std::string("bottom"));
+        co_return 0;
+    }
+    int v = co_await chain(depth - 1, fail);
+    co_return v + 1;
+}
+
+vien::expected<int, std::string> manual_chain(int depth, bool fail) {
+    if(depth == 0) {
+        if(fail)
+            return vien::unexpected(std::string("bottom"));
+        return 0;
+    }
+    auto e = manual_chain(depth - 1, fail);
+    if(!e)
+        return vien::unexpected(std::move(e).error());
+    return *e + 1;
+}
+
+/* Error type of coroutines allocated from an arena */
+struct arena_error_t {
+    int depth;
+};
+
+}
+
+template <>
+struct vien::coroutine_arena_size<int, arena_error_t> : std::integral_constant<std::size_t, 4096> { };
+
+namespace {
+
+vien::expected<int, arena_error_t> arena_chain(int depth, int fail_at) {
+    if(depth == fail_at)
+        co_return vien::unexpected(arena_error_t{depth});
+    if(depth == 0)
+        co_return 0;
+    int v = co_await arena_chain(depth - 1, fail_at);
+    co_return v + 1;
+}
+
+struct destruction_counter_t {
+    int* count;
+    ~destruction_counter_t() {
+        ++*count;
+    }
+};
+
+}
+
+TEST_CASE("co_await unwraps values", "[expected][extended][coroutines]") {
+    auto e = sum_digits('3', '4');
+
+    REQUIRE(std::is_same_v<decltype(e), vien::expected<int, std::string>>);
+    REQUIRE(e == 7);
+}
+
+TEST_CASE("co_await short-circuits on error", "[expected][extended][coroutines]") {
+    int destroyed = 0;
+    int resumed = 0;
+    auto f = [&]() -> vien::expected<int, std::string> {
+        destruction_counter_t guard{&destroyed};
+        int x = co_await parse_digit('x');
+        ++resumed;
+        co_return x;
+    };
+
+    auto e = f();
+
+    REQUIRE(!e);
+    REQUIRE(e.error() == "not a digit: x");
+    REQUIRE(resumed == 0);
+    REQUIRE(destroyed == 1);
+}
+
+TEST_CASE("coroutines propagate through deep call chains", "[expected][extended][coroutines]") {
+    REQUIRE(chain(10, false) == 10);
+    REQUIRE(chain(10, false) == manual_chain(10, false));
+
+    auto e = chain(10, true);
+    REQUIRE(!e);
+    REQUIRE(e.error() == "bottom");
+    REQUIRE(e == manual_chain(10, true));
+
+    REQUIRE(chain(2000, false) == 2000);
+    REQUIRE(chain(2000, true).error() == "bottom");
+}
+
+TEST_CASE("coroutine frames may be allocated from an arena", "[expected][extended][coroutines]") {
+    REQUIRE(vien::coroutine_arena_size<int, std::string>::value == 0u);
+
+    REQUIRE(arena_chain(10, -1) == 10);
+    REQUIRE(arena_chain(10, 3).error().depth == 3);
+
+    /* Deeper than fits in the per-thread arena */
+    REQUIRE(arena_chain(2000, -1) == 2000);
+    REQUIRE(arena_chain(2000, 1500).error().depth == 1500);
+    REQUIRE(arena_chain(2000, 10).error().depth == 10);
+}
+
+TEST_CASE("co_await converts error types", "[expected][extended][coroutines]") {
+    auto f = [](vien::expected<int, char const*> e) -> vien::expected<int, std::string> {
+        int v = co_await e;
+        co_return v * 2;
+    };
+
+    REQUIRE(f(2) == 4);
+    REQUIRE(f(vien::unexpected("err")).error() == "err");
+}
+
+TEST_CASE("co_await on lvalues yields references", "[expected][extended][coroutines]") {
+    vien::expected<std::string, int> s{"abc"};
+    auto f = [&s]() -> vien::expected<std::string const*, int> {
+        std::string& ref = co_await s;
+        co_return &ref;
+    };
+
+    REQUIRE(f() == &*s);
+}
+
+TEST_CASE("co_await moves out of rvalues", "[expected][extended][coroutines]") {
+    auto f = []() -> vien::expected<std::unique_ptr<int>, int> {
+        std::unique_ptr<int> p = co_await vien::expected<std::unique_ptr<int>, int>(std::make_unique<int>(3));
+        co_return p;
+    };
+
+    auto e = f();
+    REQUIRE(e);
+    REQUIRE(**e == 3);
+}
+
+TEST_CASE("void coroutines", "[expected][extended][coroutines]") {
+    int calls = 0;
+    auto step = [&calls](bool ok) -> vien::expected<void, int> {
+        if(!ok)
+            return vien::unexpected(calls);
+        ++calls;
+        return {};
+    };
+    auto f = [&step](bool ok) -> vien::expected<void, int> {
+        co_await step(true);
+        co_await step(ok);
+        co_await step(true);
+    };
+
+    REQUIRE(f(true));
+    REQUIRE(calls == 3);
+
+    auto e = f(false);
+    REQUIRE(!e);
+    REQUIRE(e.error() == 4);
+    REQUIRE(calls == 4);
+}
+
+TEST_CASE("exceptions propagate out of coroutines", "[expected][extended][coroutines]") {
+    auto f = []() -> vien::expected<int, int> {
+        int v = co_await vien::expected<int, int>(1);
+        if(v == 1)
+            throw std::runtime_error("thrown");
+        co_return v;
+    };
+
+    REQUIRE_THROWS_AS(f(), std::runtime_error);
+    REQUIRE(sum_digits('1', '2') == 3);
+}
+
+#endif
+#endif
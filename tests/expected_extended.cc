@@ -2,13 +2,19 @@
 #define VIEN_EXPECTED_EXTENDED
 #include "catch.hpp"
 #include "expected.h"
+#include "test_types.h"
 #include "traits.h"
+#include <algorithm>
 #include <array>
 #include <cctype>
 #include <forward_list>
 #include <functional>
 #include <map>
+#include <memory>
+#include <memory_resource>
+#include <optional>
 #include <set>
+#include <stdexcept>
 #include <string>
 #include <type_traits>
 #include <unordered_map>
@@ -21,6 +27,17 @@
 namespace expected_detail = vien::expected_detail;
 using vien::unexpect;
 
+/* Non-template container, requires a container_rebind_traits
+ * specialization for map_range */
+struct int_list_t : std::vector<int> {
+    using std::vector<int>::vector;
+};
+
+template <typename T>
+struct vien::container_rebind_traits<int_list_t, T> {
+    using type = std::vector<T>;
+};
+
 TEST_CASE("map returns correct value", "[expected][extended][map]") {
     vien::expected<int, double> e1(10);
     vien::expected<int, int> e2(unexpect, 20);
@@ -265,6 +282,154 @@ TEST_CASE("map_range works for standard array with non-default constructible val
     REQUIRE(e2 == an);
 }
 
+TEST_CASE("map_range works for large standard array", "[expected][extended][map_range][array]") {
+    struct non_default_t {
+        non_default_t(int j) : i{j} { };
+
+        int i;
+    };
+
+    constexpr std::size_t size = 4096u;
+    static_assert(size > VIEN_EXPECTED_ARRAY_UNROLL_LIMIT);
+
+    std::array<int, size> ai;
+    for(std::size_t i = 0u; i < size; ++i)
+        ai[i] = static_cast<int>(i);
+
+    vien::expected<std::array<int, size>, int> e1{ai};
+
+    auto e2 = e1.map_range([](int i) {
+        return non_default_t(2 * i);
+    });
+
+    REQUIRE(std::is_same_v<decltype(e2), vien::expected<std::array<non_default_t, size>, int>>);
+    REQUIRE(bool(e2));
+    REQUIRE(std::all_of(std::begin(*e2), std::end(*e2), [&e2](non_default_t const& n) {
+        return n.i == 2 * static_cast<int>(&n - e2->data());
+    }));
+
+    auto e3 = e1.map_range([](int i) {
+        return static_cast<double>(i);
+    });
+
+    REQUIRE(bool(e3));
+    REQUIRE((*e3)[size - 1u] == static_cast<double>(size - 1u));
+}
+
+TEST_CASE("map_range destroys constructed elements of large standard array on exception", "[expected][extended][map_range][array]") {
+    static int instances = 0;
+    struct counted_t {
+        counted_t(int j) : i{j} { ++instances; }
+        counted_t(counted_t const& other) : i{other.i} { ++instances; }
+        ~counted_t() { --instances; }
+
+        int i;
+    };
+
+    std::array<int, 1024> ai{};
+    ai[512] = 1;
+    vien::expected<std::array<int, 1024>, int> e1{ai};
+
+    REQUIRE_THROWS_AS(e1.map_range([](int i) {
+        if(i)
+            throw std::runtime_error("thrown");
+        return counted_t(i);
+    }), std::runtime_error);
+    REQUIRE(instances == 0);
+}
+
+TEST_CASE("map_range rebinds templates with non-type parameters", "[expected][extended][map_range][rebind]") {
+    REQUIRE(std::is_same_v<expected_detail::rebind_t<small_vector_t<int, 8>, double>,
+                           small_vector_t<double, 8>>);
+    REQUIRE(std::is_same_v<expected_detail::rebind_t<std::array<int, 8>, double>,
+                           std::array<double, 8>>);
+
+    vien::expected<small_vector_t<int, 4>, int> e1(small_vector_t<int, 4>{1, 2, 3});
+
+    auto e2 = e1.map_range([](int i) {
+        return i * 0.5;
+    });
+
+    REQUIRE(std::is_same_v<decltype(e2), vien::expected<small_vector_t<double, 4>, int>>);
+    REQUIRE(e2 == small_vector_t<double, 4>{0.5, 1.0, 1.5});
+}
+
+TEST_CASE("map_range uses container_rebind_traits", "[expected][extended][map_range][rebind]") {
+    vien::expected<int_list_t, int> e1(int_list_t{1, 2, 3});
+
+    auto e2 = e1.map_range([](int i) {
+        return std::to_string(i);
+    });
+
+    REQUIRE(std::is_same_v<decltype(e2), vien::expected<std::vector<std::string>, int>>);
+    REQUIRE(e2 == std::vector<std::string>{"1", "2", "3"});
+
+    auto e3 = e1.filter_map_range([](int i) {
+        return std::make_pair(i != 2, i);
+    });
+
+    REQUIRE(std::is_same_v<decltype(e3), vien::expected<std::vector<int>, int>>);
+    REQUIRE(e3 == std::vector<int>{1, 3});
+}
+
+TEST_CASE("map_range propagates source allocator", "[expected][extended][map_range][allocator]") {
+    std::pmr::monotonic_buffer_resource arena;
+    std::pmr::vector<int> v({1, 2, 3}, &arena);
+    vien::expected<std::pmr::vector<int>, int> e1(std::move(v));
+
+    auto e2 = e1.map_range([](int i) {
+        return 2.0 * i;
+    });
+
+    REQUIRE(std::is_same_v<decltype(e2), vien::expected<std::pmr::vector<double>, int>>);
+    REQUIRE(e2->get_allocator().resource() == &arena);
+    REQUIRE(*e2 == std::pmr::vector<double>{2.0, 4.0, 6.0});
+
+    auto e3 = e1.filter_map_range([](int i) {
+        return std::make_pair(i > 1, i);
+    });
+    REQUIRE(e3->get_allocator().resource() == &arena);
+
+    auto e4 = e1.flat_map_range([](int i) {
+        return std::array<int, 2>{i, i};
+    });
+    REQUIRE(e4->get_allocator().resource() == &arena);
+
+    std::pmr::map<int, int> m({{1, 2}}, &arena);
+    vien::expected<std::pmr::map<int, int>, int> e5(std::move(m));
+    auto e6 = e5.map_range([](auto const& pair) {
+        return static_cast<double>(pair.second);
+    });
+    REQUIRE(e6->get_allocator().resource() == &arena);
+}
+
+TEST_CASE("map_range uses explicit allocator", "[expected][extended][map_range][allocator]") {
+    std::pmr::monotonic_buffer_resource arena;
+    vien::expected<std::pmr::vector<int>, int> e1(std::pmr::vector<int>{1, 2, 3});
+
+    auto e2 = e1.map_range(std::allocator_arg, std::pmr::polymorphic_allocator<int>(&arena), [](int i) {
+        return std::to_string(i);
+    });
+
+    REQUIRE(std::is_same_v<decltype(e2), vien::expected<std::pmr::vector<std::string>, int>>);
+    REQUIRE(e2->get_allocator().resource() == &arena);
+    REQUIRE(*e2 == std::pmr::vector<std::string>{"1", "2", "3"});
+
+    auto e3 = std::move(e1).map_range(std::allocator_arg, std::pmr::polymorphic_allocator<int>(&arena), [](int i) {
+        return i + 1;
+    });
+
+    REQUIRE(e3->get_allocator().resource() == &arena);
+    REQUIRE(*e3 == std::pmr::vector<int>{2, 3, 4});
+
+    vien::expected<std::pmr::vector<int>, int> e4(unexpect, 5);
+    auto e5 = e4.map_range(std::allocator_arg, std::pmr::polymorphic_allocator<int>(&arena), [](int i) {
+        return i;
+    });
+
+    REQUIRE(e5 == vien::unexpected(5));
+}
+
 TEST_CASE("map_range works for insert-only container", "[expected][extended][map_range][insert]") {
     std::set<int> si{1,2};
     std::set<std::string> ss{"1","2", "4"};
@@ -376,6 +541,53 @@ TEST_CASE("map_range works for std::string", "[expected][extended][map_range][st
     REQUIRE(*e2 == "EXPECTED");
 }
 
+TEST_CASE("map_range with pure callable uses lookup table for long byte strings", "[expected][extended][map_range][pure]") {
+    static int invocations = 0;
+    auto to_upper = vien::pure([](unsigned char c) {
+        ++invocations;
+        #ifndef _MSC_VER
+        using std::toupper;
+        #endif
+        return toupper(c);
+    });
+
+    std::string str(4 * expected_detail::byte_table_threshold, 'x');
+    str[0] = 'a';
+    vien::expected<std::string, int> e1(str);
+
+    auto e2 = e1.map_range(to_upper);
+    REQUIRE(std::is_same_v<decltype(e2), vien::expected<std::string, int>>);
+    REQUIRE(invocations == 256);
+    REQUIRE(e2->front() == 'A');
+    REQUIRE(e2->find_first_not_of('X', 1) == std::string::npos);
+
+    invocations = 0;
+    auto e3 = std::move(e1).map_range(to_upper);
+    REQUIRE(invocations == 256);
+    REQUIRE(e3 == *e2);
+
+    invocations = 0;
+    vien::expected<std::string, int> e4("short");
+    auto e5 = e4.map_range(to_upper);
+    REQUIRE(invocations == 5);
+    REQUIRE(e5 == "SHORT");
+}
+
+TEST_CASE("map_range lookup table passes the same characters as the per-character path", "[expected][extended][map_range][pure]") {
+    auto offset = vien::pure([](int c) {
+        return static_cast<char>(c < 0 ? c + 1 : c + 2);
+    });
+
+    std::string short_str{'a', static_cast<char>(0xe9), static_cast<char>(0xff)};
+    std::string long_str(expected_detail::byte_table_threshold, 'x');
+    long_str.replace(0u, short_str.size(), short_str);
+
+    auto e1 = vien::expected<std::string, int>(short_str).map_range(offset);
+    auto e2 = vien::expected<std::string, int>(long_str).map_range(offset);
+
+    REQUIRE(e2->compare(0u, e1->size(), *e1) == 0);
+}
+
 TEST_CASE("map_range works for std::basic_string with non-char type", "[expected][extended][map_range]") {
     std::basic_string<bool> s1{false, false, true};
     std::basic_string<bool> s2{true, true, false};
@@ -385,6 +597,302 @@ TEST_CASE("map_range works for std::basic_string with non-char type", "[expected
     REQUIRE(*e2 == s2);
 }
 
+TEST_CASE("map_range_into writes to output iterator", "[expected][extended][map_range_into]") {
+    vien::expected<std::vector<int>, int> e1(std::vector<int>{1,2,3});
+    std::vector<std::string> v;
+    v.reserve(3);
+
+    auto e2 = e1.map_range_into(std::back_inserter(v), [](int i) { return std::to_string(i); });
+
+    REQUIRE(std::is_same_v<decltype(e2), vien::expected<std::back_insert_iterator<std::vector<std::string>>, int>>);
+    REQUIRE(bool(e2));
+    REQUIRE(v == std::vector<std::string>{"1", "2", "3"});
+
+    int buf[4]{};
+    auto e3 = e1.map_range_into(static_cast<int*>(buf), [](int i) { return 2 * i; });
+
+    REQUIRE(bool(e3));
+    REQUIRE(*e3 == buf + 3);
+    REQUIRE(buf[2] == 6);
+    REQUIRE(buf[3] == 0);
+}
+
+TEST_CASE("map_range_into writes to range", "[expected][extended][map_range_into]") {
+    vien::expected<std::vector<int>, int> e1(std::vector<int>{1,2,3,4,5});
+    std::array<int, 3> a{};
+
+    auto e2 = e1.map_range_into(a, [](int i) { return 10 * i; });
+
+    REQUIRE(std::is_same_v<decltype(e2), vien::expected<std::size_t, int>>);
+    REQUIRE(e2 == 3u);
+    REQUIRE(a == std::array<int, 3>{10, 20, 30});
+
+    int buf[8]{};
+    auto e3 = e1.map_range_into(buf, [](int i) { return -i; });
+    REQUIRE(e3 == 5u);
+    REQUIRE(buf[4] == -5);
+    REQUIRE(buf[5] == 0);
+}
+
+TEST_CASE("map_range_into leaves destination untouched when !bool(*this)", "[expected][extended][map_range_into]") {
+    vien::expected<std::vector<int>, std::string> e1(unexpect, "error");
+    std::vector<int> v;
+
+    auto e2 = e1.map_range_into(std::back_inserter(v), [](int i) { return i; });
+    auto e3 = e1.map_range_into(v, [](int i) { return i; });
+
+    REQUIRE(!bool(e2));
+    REQUIRE(e2.error() == "error");
+    REQUIRE(e3 == vien::unexpected(std::string("error")));
+    REQUIRE(v.empty());
+}
+
+TEST_CASE("map_range_into moves elements out of rvalue", "[expected][extended][map_range_into]") {
+    vien::expected<std::vector<std::string>, int> e1(std::vector<std::string>{"a", "b"});
+    std::vector<std::string> v;
+
+    auto e2 = std::move(e1).map_range_into(std::back_inserter(v), [](std::string&& str) {
+        return std::move(str);
+    });
+
+    REQUIRE(bool(e2));
+    REQUIRE(v == std::vector<std::string>{"a", "b"});
+}
+
+TEST_CASE("flat_map_range flattens nested containers", "[expected][extended][flat_map_range]") {
+    using nested_t = std::vector<std::vector<int>>;
+    vien::expected<nested_t, int> e1(nested_t{{1, 2}, {}, {3, 4, 5}});
+
+    auto e2 = e1.flat_map_range([](std::vector<int> const& v) {
+        std::vector<std::string> strs;
+        for(int i : v)
+            strs.push_back(std::to_string(i));
+        return strs;
+    });
+
+    REQUIRE(std::is_same_v<decltype(e2), vien::expected<std::vector<std::string>, int>>);
+    REQUIRE(bool(e2));
+    REQUIRE(*e2 == std::vector<std::string>{"1", "2", "3", "4", "5"});
+
+    auto e3 = e1.flat_map_range([](std::vector<int> const& v) -> std::vector<int> const& {
+        return v;
+    });
+
+    REQUIRE(std::is_same_v<decltype(e3), vien::expected<std::vector<int>, int>>);
+    REQUIRE(e3 == std::vector<int>{1, 2, 3, 4, 5});
+    REQUIRE((*e1)[2].size() == 3u);
+}
+
+TEST_CASE("flat_map_range allocates once for sized ranges", "[expected][extended][flat_map_range]") {
+    counting_resource_t resource;
+    using inner_t = std::pmr::vector<int>;
+    std::pmr::vector<inner_t> nested(&resource);
+    nested.push_back(inner_t{1, 2});
+    nested.push_back(inner_t{});
+    nested.push_back(inner_t{3, 4, 5});
+    vien::expected<std::pmr::vector<inner_t>, int> e1(std::move(nested));
+
+    resource.reset();
+    auto e2 = e1.flat_map_range([](inner_t const& v) -> inner_t const& {
+        return v;
+    });
+    REQUIRE(e2 == std::pmr::vector<int>{1, 2, 3, 4, 5});
+    REQUIRE(resource.allocations() == 1u);
+
+    resource.reset();
+    auto e3 = e1.flat_map_range([](inner_t const& v) {
+        return std::vector<int>(v.size(), 7);
+    });
+    REQUIRE(e3 == std::pmr::vector<int>{7, 7, 7, 7, 7});
+    REQUIRE(resource.allocations() == 1u);
+}
+
+TEST_CASE("flat_map_range with callables changing element count", "[expected][extended][flat_map_range]") {
+    vien::expected<std::vector<std::string>, int> e1(std::vector<std::string>{"abc", "de"});
+
+    auto e2 = e1.flat_map_range([](std::string const& s) {
+        return std::array<std::size_t, 2>{s.size(), s.size() * 2u};
+    });
+    auto e3 = e1.flat_map_range([](std::string const& s) {
+        return std::vector<char>(1u, s.front());
+    });
+
+    REQUIRE(*e2 == std::vector<std::size_t>{3u, 6u, 2u, 4u});
+    REQUIRE(e2->capacity() >= 4u);
+    REQUIRE(*e3 == std::vector<char>{'a', 'd'});
+}
+
+TEST_CASE("flat_map_range propagates error", "[expected][extended][flat_map_range]") {
+    vien::expected<std::vector<int>, std::string> e1(unexpect, "error");
+
+    auto e2 = e1.flat_map_range([](int i) { return std::vector<int>(2, i); });
+
+    REQUIRE(std::is_same_v<decltype(e2), vien::expected<std::vector<int>, std::string>>);
+    REQUIRE(e2 == vien::unexpected(std::string("error")));
+}
+
+TEST_CASE("flat_map_range moves from rvalue", "[expected][extended][flat_map_range]") {
+    using nested_t = std::vector<std::vector<std::string>>;
+    vien::expected<nested_t, int> e1(nested_t{{"a", "b"}, {"c"}});
+
+    auto e2 = std::move(e1).flat_map_range([](std::vector<std::string>&& v) {
+        return std::move(v);
+    });
+
+    REQUIRE(e2 == std::vector<std::string>{"a", "b", "c"});
+}
+
+TEST_CASE("flat_map_range works for insert-only container", "[expected][extended][flat_map_range][insert]") {
+    vien::expected<std::set<int>, int> e1(std::set<int>{1, 2});
+
+    auto e2 = e1.flat_map_range([](int i) {
+        return std::array<int, 2>{i, 10 * i};
+    });
+
+    REQUIRE(std::is_same_v<decltype(e2), vien::expected<std::set<int>, int>>);
+    REQUIRE(e2 == std::set<int>{1, 2, 10, 20});
+}
+
+TEST_CASE("filter_map_range transforms and filters in one pass", "[expected][extended][filter_map_range]") {
+    vien::expected<std::vector<int>, int> e1(std::vector<int>{1, 2, 3, 4, 5, 6});
+
+    auto e2 = e1.filter_map_range([](int i) {
+        return i % 2 ? std::nullopt : std::optional<std::string>(std::to_string(i));
+    });
+
+    REQUIRE(std::is_same_v<decltype(e2), vien::expected<std::vector<std::string>, int>>);
+    REQUIRE(e2 == std::vector<std::string>{"2", "4", "6"});
+    REQUIRE(e2->capacity() >= e2->size());
+
+    auto e3 = e1.filter_map_range(vien::shrink_to_fit, [](int i) {
+        return std::make_pair(i > 4, 2.0 * i);
+    });
+
+    REQUIRE(std::is_same_v<decltype(e3), vien::expected<std::vector<double>, int>>);
+    REQUIRE(e3 == std::vector<double>{10.0, 12.0});
+    REQUIRE(e3->capacity() >= e3->size());
+}
+
+TEST_CASE("filter_map_range preallocates once", "[expected][extended][filter_map_range]") {
+    counting_resource_t resource;
+    vien::expected<std::pmr::vector<int>, int> e1(std::pmr::vector<int>({1, 2, 3, 4, 5, 6}, &resource));
+
+    resource.reset();
+    auto e2 = e1.filter_map_range([](int i) {
+        return i % 2 ? std::nullopt : std::optional<int>(i);
+    });
+
+    REQUIRE(std::is_same_v<decltype(e2), vien::expected<std::pmr::vector<int>, int>>);
+    REQUIRE(e2 == std::pmr::vector<int>{2, 4, 6});
+    REQUIRE(resource.allocations() == 1u);
+}
+
+TEST_CASE("filter_map_range propagates error", "[expected][extended][filter_map_range]") {
+    vien::expected<std::vector<int>, std::string> e1(unexpect, "error");
+
+    auto e2 = std::move(e1).filter_map_range([](int i) { return std::optional<int>(i); });
+
+    REQUIRE(e2 == vien::unexpected(std::string("error")));
+}
+
+TEST_CASE("filter_map_range works for associative container", "[expected][extended][filter_map_range]") {
+    std::map<std::string, int> m1{{"a", 1}, {"b", 2}, {"c", 3}};
+    vien::expected<std::map<std::string, int>, int> e1(std::move(m1));
+
+    auto e2 = e1.filter_map_range([](auto const& pair) {
+        return pair.second == 2 ? std::nullopt : std::optional<double>(pair.second);
+    });
+
+    REQUIRE(std::is_same_v<decltype(e2), vien::expected<std::map<std::string, double>, int>>);
+    REQUIRE(e2 == std::map<std::string, double>{{"a", 1.0}, {"c", 3.0}});
+
+    auto e3 = e1.filter_map_range([](auto const& pair) {
+        return std::make_pair(pair.first != "a", std::make_pair(pair.second, pair.first));
+    });
+
+    REQUIRE(std::is_same_v<decltype(e3), vien::expected<std::map<int, std::string>, int>>);
+    REQUIRE(e3 == std::map<int, std::string>{{2, "b"}, {3, "c"}});
+}
+
+namespace {
+vien::expected<int, std::string> parse_digit(char c) {
+    if(c < '0' || c > '9')
+        return vien::unexpected(std::string(1, c));
+    return c - '0';
+}
+
+vien::expected<std::unique_ptr<int>, std::string> make_ptr(int i) {
+    if(i < 0)
+        return vien::unexpected(std::string("negative"));
+    return std::make_unique<int>(i);
+}
+
+vien::expected<void, std::string> check_positive(int i) {
+    if(i <= 0)
+        return vien::unexpected(std::string("non-positive"));
+    return {};
+}
+
+/* Error type constructible from std::string */
+struct wrapped_error_t {
+    wrapped_error_t(std::string str) : msg{std::move(str)} { }
+
+    std::string msg;
+};
+
+#if defined(__GNUC__) || defined(__clang__)
+vien::expected<int, wrapped_error_t> sum_digits(char a, char b) {
+    int i = VIEN_TRY(parse_digit(a));
+    auto p = VIEN_TRY(make_ptr(VIEN_TRY(parse_digit(b))));
+    VIEN_TRY(check_positive(i + *p));
+    return i + *p;
+}
+#endif
+
+vien::expected<int, wrapped_error_t> sum_digits_portable(char a, char b) {
+    VIEN_TRY_ASSIGN(int i, parse_digit(a));
+    VIEN_TRY_ASSIGN(auto p, make_ptr(i));
+    VIEN_TRY_ASSIGN(int j, parse_digit(b));
+    VIEN_TRY_VOID(check_positive(*p + j));
+    return *p + j;
+}
+}
+
+#if defined(__GNUC__) || defined(__clang__)
+TEST_CASE("VIEN_TRY evaluates to value or returns error", "[expected][extended][try]") {
+    auto e1 = sum_digits('1', '2');
+    REQUIRE(e1 == 3);
+
+    auto e2 = sum_digits('1', 'x');
+    REQUIRE(!bool(e2));
+    REQUIRE(e2.error().msg == "x");
+
+    auto e3 = sum_digits('0', '0');
+    REQUIRE(!bool(e3));
+    REQUIRE(e3.error().msg == "non-positive");
+
+    vien::expected<std::string, std::string> e4("moved");
+    auto f = [&e4]() -> vien::expected<std::string, std::string> {
+        std::string str = VIEN_TRY(std::move(e4));
+        return str;
+    };
+    REQUIRE(f() == "moved");
+    REQUIRE(e4->empty());
+}
+#endif
+
+TEST_CASE("VIEN_TRY_ASSIGN assigns value or returns error", "[expected][extended][try]") {
+    auto e1 = sum_digits_portable('1', '2');
+    REQUIRE(e1 == 3);
+
+    auto e2 = sum_digits_portable('y', '2');
+    REQUIRE(!bool(e2));
+    REQUIRE(e2.error().msg == "y");
+
+    auto e3 = sum_digits_portable('0', '0');
+    REQUIRE(e3.error().msg == "non-positive");
+}
+
 TEST_CASE("map_or_else invokes callables correctly", "[expected][extended][map_or_else]") {
     vien::expected<int, std::string> e1(unexpect, "12");
     vien::expected<int, std::string> e2(10);
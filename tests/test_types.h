@@ -1,6 +1,11 @@
 #ifndef EXPECTED_TEST_TYPES_H
 #define EXPECTED_TEST_TYPES_H
 
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <initializer_list>
+#include <memory_resource>
 #include <numeric>
 #include <stdexcept>
 
@@ -123,4 +128,86 @@ namespace std {
     void swap(swap_test_t<T>&, swap_test_t<T>&) { }
 }
 
+/* Minimal vector with inline capacity N, used for testing rebinding
+ * of templates with non-type parameters */
+template <typename T, std::size_t N>
+class small_vector_t {
+    public:
+        using value_type = T;
+        using iterator = typename std::array<T, N>::iterator;
+        using const_iterator = typename std::array<T, N>::const_iterator;
+
+        small_vector_t() = default;
+        small_vector_t(std::initializer_list<T> il) {
+            for(auto const& v : il)
+                push_back(v);
+        }
+
+        void push_back(T const& v) {
+            if(size_ == N)
+                throw std::length_error("small_vector_t capacity exceeded");
+            buf_[size_++] = v;
+        }
+
+        std::size_t size() const noexcept {
+            return size_;
+        }
+
+        static constexpr std::size_t capacity() noexcept {
+            return N;
+        }
+
+        iterator begin() noexcept {
+            return buf_.begin();
+        }
+
+        const_iterator begin() const noexcept {
+            return buf_.begin();
+        }
+
+        iterator end() noexcept {
+            return buf_.begin() + size_;
+        }
+
+        const_iterator end() const noexcept {
+            return buf_.begin() + size_;
+        }
+
+        bool operator==(small_vector_t const& rhs) const {
+            return size_ == rhs.size_ && std::equal(begin(), end(), rhs.begin());
+        }
+
+    private:
+        std::array<T, N> buf_{};
+        std::size_t size_{0};
+};
+
+/* Memory resource counting the allocations made through it */
+class counting_resource_t : public std::pmr::memory_resource {
+    public:
+        std::size_t allocations() const noexcept {
+            return allocations_;
+        }
+
+        void reset() noexcept {
+            allocations_ = 0u;
+        }
+
+    private:
+        std::size_t allocations_{0u};
+
+        void* do_allocate(std::size_t bytes, std::size_t alignment) override {
+            ++allocations_;
+            return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+        }
+
+        void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
+            std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+        }
+
+        bool do_is_equal(std::pmr::memory_resource const& other) const noexcept override {
+            return this == &other;
+        }
+};
+
 #endif